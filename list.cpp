@@ -1,9 +1,17 @@
 #include <iostream>
+#include <atomic>
 #include <functional>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
-template<typename Type>
+template<typename Type, typename Allocator=std::allocator<Type>>
 class List;
 
 namespace
@@ -34,7 +42,8 @@ struct Node
 	}
 
 private:
-	friend class List<Type>;
+	template<typename, typename>
+	friend class ::List;
 	friend struct Iterator<Type>;
 	friend struct Const_Iterator<Type>;
 
@@ -110,7 +119,8 @@ struct Iterator
 	template<typename T>
 	friend Iterator<T> & operator-(Iterator<T> &lhs, int32_t n);
 
-	friend class List<Type>;
+	template<typename, typename>
+	friend class ::List;
 
 protected:
 	NodePtr<Type> current_{nullptr};
@@ -156,7 +166,8 @@ struct Const_Iterator: public Iterator<Type>
 		return current_->data_;
 	}
 
-	friend class List<Type>;
+	template<typename, typename>
+	friend class ::List;
 };
 
 template<typename Type>
@@ -193,53 +204,317 @@ Iterator<Type> & operator-(Iterator<Type> &lhs, int32_t n)
 
 }
 
-template<typename Type>
+/**
+ * Fixed size slot arena for list nodes. The slot size is taken from the first
+ * allocation, slots are carved out of blocks that double from 16 slots up to
+ * 64KB, freed slots go to an intrusive free list and are reused before the
+ * block cursor moves on. Requests that do not fit a slot go to operator new.
+ * All blocks are returned when the arena is destroyed.
+ */
+class NodeArena
+{
+public:
+	NodeArena() = default;
+
+	NodeArena(NodeArena const &) = delete;
+	NodeArena & operator=(NodeArena const &) = delete;
+
+	~NodeArena()
+	{
+		while (blocks_ != nullptr)
+		{
+			Block *block = blocks_;
+			blocks_ = block->next_;
+			::operator delete(block, std::align_val_t(slotAlign_));
+		}
+	}
+
+	void * allocate(size_t const size, size_t const align)
+	{
+		if (slotSize_ == 0)
+			__setSlot(size, align);
+
+		if (! __pooled(size, align))
+			return ::operator new(size, std::align_val_t(align));
+
+		if (free_ != nullptr)
+		{
+			FreeSlot *slot = free_;
+			free_ = slot->next_;
+			return slot;
+		}
+
+		if (cursor_ == end_)
+			__grow();
+
+		void *slot = cursor_;
+		cursor_ += slotSize_;
+		return slot;
+	}
+
+	void deallocate(void *ptr, size_t const size, size_t const align) noexcept
+	{
+		if (! __pooled(size, align))
+			return ::operator delete(ptr, std::align_val_t(align));
+
+		FreeSlot *slot = static_cast<FreeSlot *>(ptr);
+		slot->next_ = free_;
+		free_ = slot;
+	}
+
+	/**
+	 * Bytes taken from operator new for blocks, used or not
+	 */
+	size_t reserved() const noexcept { return reserved_; }
+
+private:
+	struct FreeSlot
+	{
+		FreeSlot *next_;
+	};
+
+	struct Block
+	{
+		Block *next_;
+	};
+
+	static constexpr size_t MIN_SLOTS = 16;
+	static constexpr size_t MAX_BLOCK_SIZE = 64 * 1024;
+
+	void __setSlot(size_t const size, size_t const align) noexcept
+	{
+		slotAlign_ = std::max({align, alignof(FreeSlot), alignof(Block)});
+		slotSize_ = (std::max(size, sizeof(FreeSlot)) + slotAlign_ - 1) / slotAlign_ * slotAlign_;
+		blockSlots_ = MIN_SLOTS;
+	}
+
+	bool __pooled(size_t const size, size_t const align) const noexcept
+	{
+		return size <= slotSize_ && align <= slotAlign_;
+	}
+
+	void __grow()
+	{
+		//The block header takes one slot so the slots after it stay aligned
+		size_t const bytes = (blockSlots_ + 1) * slotSize_;
+		char *memory = static_cast<char *>(::operator new(bytes, std::align_val_t(slotAlign_)));
+
+		Block *block = reinterpret_cast<Block *>(memory);
+		block->next_ = blocks_;
+		blocks_ = block;
+
+		cursor_ = memory + slotSize_;
+		end_ = memory + bytes;
+		reserved_ += bytes;
+
+		if ((blockSlots_ * 2 + 1) * slotSize_ <= MAX_BLOCK_SIZE)
+			blockSlots_ *= 2;
+	}
+
+	FreeSlot *free_{nullptr};
+	char *cursor_{nullptr};
+	char *end_{nullptr};
+	Block *blocks_{nullptr};
+	size_t slotSize_{0};
+	size_t slotAlign_{0};
+	size_t blockSlots_{0};
+	size_t reserved_{0};
+};
+
+/**
+ * Stateless allocator, single objects come from a NodeArena shared by all
+ * containers of the calling thread with the same object size and alignment,
+ * arrays from std::allocator. The arena of a thread is never destroyed, so nodes
+ * may outlive their thread and may be freed on another thread, where they join
+ * the free list of that thread.
+ */
+template<typename T>
+struct PoolAllocator
+{
+	using value_type = T;
+
+	PoolAllocator() = default;
+
+	template<typename U>
+	PoolAllocator(PoolAllocator<U> const &) noexcept
+	{
+	}
+
+	T * allocate(size_t const n)
+	{
+		if (n != 1)
+			return std::allocator<T>().allocate(n);
+
+		return static_cast<T *>(__arena().allocate(sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *ptr, size_t const n) noexcept
+	{
+		if (n != 1)
+			std::allocator<T>().deallocate(ptr, n);
+		else
+			__arena().deallocate(ptr, sizeof(T), alignof(T));
+	}
+
+	template<typename U>
+	bool operator==(PoolAllocator<U> const &) const noexcept
+	{
+		return true;
+	}
+
+	template<typename U>
+	bool operator!=(PoolAllocator<U> const &) const noexcept
+	{
+		return false;
+	}
+
+private:
+	static NodeArena & __arena()
+	{
+		thread_local NodeArena *arena = new NodeArena;
+		return *arena;
+	}
+};
+
+/**
+ * Allocator owning a NodeArena, a default constructed allocator creates a new
+ * arena and copies share it. A List copy gets its own arena, moved and swapped
+ * Lists take their arena with them. Passing the same allocator to several Lists
+ * lets them share one arena, their memory is returned when the last of them is
+ * destroyed.
+ */
+template<typename T>
+struct ArenaAllocator
+{
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator(): arena_{std::make_shared<NodeArena>()}
+	{
+	}
+
+	template<typename U>
+	ArenaAllocator(ArenaAllocator<U> const &alloc) noexcept: arena_{alloc.arena_}
+	{
+	}
+
+	ArenaAllocator select_on_container_copy_construction() const
+	{
+		return ArenaAllocator{};
+	}
+
+	T * allocate(size_t const n)
+	{
+		if (n != 1)
+			return std::allocator<T>().allocate(n);
+
+		return static_cast<T *>(arena_->allocate(sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *ptr, size_t const n) noexcept
+	{
+		if (n != 1)
+			std::allocator<T>().deallocate(ptr, n);
+		else
+			arena_->deallocate(ptr, sizeof(T), alignof(T));
+	}
+
+	NodeArena const & arena() const noexcept { return *arena_; }
+
+	template<typename U>
+	bool operator==(ArenaAllocator<U> const &alloc) const noexcept
+	{
+		return arena_ == alloc.arena_;
+	}
+
+	template<typename U>
+	bool operator!=(ArenaAllocator<U> const &alloc) const noexcept
+	{
+		return arena_ != alloc.arena_;
+	}
+
+private:
+	template<typename U>
+	friend struct ArenaAllocator;
+
+	std::shared_ptr<NodeArena> arena_;
+};
+
+/**
+ * Relink: bottom up merge sort relinking the nodes, no allocation and no element copies.
+ * PointerArray: stable sorts an array of node pointers (together with a copy of
+ * small trivially copyable values) and links the nodes in its order, the sort
+ * itself works on contiguous memory. Needs length * 8 to 24 bytes.
+ */
+enum class SortStrategy
+{
+	Relink,
+	PointerArray
+};
+
+/**
+ * Doubly linked list, nodes are allocated with Allocator rebound to the node
+ * type. PoolAllocator recycles nodes through a thread local arena, ArenaAllocator
+ * through an arena owned by the List (or shared by the Lists it is passed to).
+ */
+template<typename Type, typename Allocator>
 class List
 {
+	using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node<Type>>;
+	using NodeTraits = std::allocator_traits<NodeAllocator>;
+
 public:
 	using iterator = Iterator<Type>;
 	using const_iterator = Const_Iterator<Type>;
+	using allocator_type = Allocator;
 
 	List() = default;
 
+	explicit List(Allocator const &alloc): alloc_{alloc}
+	{
+	}
+
 	~List()
 	{
 		__removeAll();
 	}
 
-	List(uint32_t size, Type const &val=Type{})
+	List(uint32_t size, Type const &val=Type{}, Allocator const &alloc=Allocator{}): alloc_{alloc}
 	{
 		for (uint32_t i = 0; i < size; ++i)
 			push_back(val);
 	}
 
-	List(List<Type> const &list)
+	List(List const &list): alloc_{NodeTraits::select_on_container_copy_construction(list.alloc_)}
 	{
 		for (auto const &ele: list)
 			push_back(ele);
 	}
 
-	List(List<Type> &&list)
+	//The allocator is copied, the moved from list stays usable
+	List(List &&list): alloc_{list.alloc_}
 	{
-		swap(list);
+		__swapNodes(list);
 	}
 
-	List<Type> & operator=(List<Type> const &list)
+	List & operator=(List const &list)
 	{
 		if (this != &list)
 		{
-			List<Type> anotherList;
+			List anotherList(alloc_);
 
 			for (auto const &ele: list)
 				anotherList.push_back(ele);
 
-			swap(anotherList);
+			__swapNodes(anotherList);
 		}
 
 		return *this;
 	}
 
-	List<Type> & operator=(List<Type> &&list)
+	List & operator=(List &&list)
 	{
 		if (this != &list)
 			swap(list);
@@ -247,6 +522,11 @@ public:
 		return *this;
 	}
 
+	allocator_type get_allocator() const
+	{
+		return allocator_type(alloc_);
+	}
+
 	const_iterator begin() const
 	{
 		return const_iterator(head_);
@@ -267,10 +547,13 @@ public:
 		return iterator(nullptr);
 	}
 
-	void insert(iterator const &position, Type const &val, uint32_t const count=1);
+	/**
+	 * return: iterator to the first inserted element, position if count is 0
+	 */
+	iterator insert(iterator const &position, Type const &val, uint32_t const count=1);
 
 	template<typename ... Args>
-	void emplace(iterator const &position, Args&&... args);
+	iterator emplace(iterator const &position, Args&&... args);
 
 	template<typename ... Args>
 	void emplace_back(Args&&... args);
@@ -284,11 +567,48 @@ public:
 	void pop_back();
 	void pop_front();
 
+	/**
+	 * Removes every element equal to data in one pass, return: removed count
+	 */
 	uint32_t remove(Type const &data);
 	iterator find(Type const &data);
 	const_iterator find(Type const &data) const;
 
-	void sort(std::function<bool(Type const &lhs, Type const &rhs)> func) noexcept;
+	/**
+	 * Destroys the element(s) at position or in [first, last), return: iterator
+	 * to the element after the erased ones
+	 */
+	iterator erase(iterator const &position);
+	iterator erase(iterator const &first, iterator const &last);
+
+	/**
+	 * Moves nodes of list before position by relinking them, no element is
+	 * copied or reallocated and iterators to the moved elements stay valid.
+	 * Whole list and single node are O(1), a range from another list walks it
+	 * once to count it (O(1) within the same list). Both lists must have equal
+	 * allocators, position must not be inside the moved range.
+	 */
+	void splice(iterator const &position, List &list) noexcept;
+	void splice(iterator const &position, List &&list) noexcept { splice(position, list); }
+	void splice(iterator const &position, List &list, iterator const &it) noexcept;
+	void splice(iterator const &position, List &list, iterator const &first, iterator const &last) noexcept;
+
+	/**
+	 * Merges the sorted list into this sorted list in one pass over both, by
+	 * relinking. Stable, elements of this list go first among equal ones.
+	 * Both lists must have equal allocators.
+	 */
+	template<typename Compare=std::less<Type>>
+	void merge(List &list, Compare comp=Compare{});
+
+	template<typename Compare=std::less<Type>>
+	void merge(List &&list, Compare comp=Compare{}) { merge(list, comp); }
+
+	/**
+	 * Stable sort by comp, called directly (no type erasure) for every comparison
+	 */
+	template<typename Compare=std::less<Type>>
+	void sort(Compare comp=Compare{}, SortStrategy strategy=SortStrategy::Relink);
 	void reverse() noexcept;
 
 	Type const & front() const noexcept { return head_->data_; }
@@ -305,37 +625,61 @@ public:
 	}
 
 	void swap(List &list) noexcept
+	{
+		std::swap(list.alloc_, alloc_);
+		__swapNodes(list);
+	}
+
+private:
+	void __swapNodes(List &list) noexcept
 	{
 		std::swap(list.head_, head_);
 		std::swap(list.tail_, tail_);
 		std::swap(list.length_, length_);
 	}
 
-private:
 	NodePtr<Type> __createNode(Type data)
 	{
-		++length_;
-		return new Node<Type>(data);
+		return __constructNode(data);
 	}
 
 	template<typename ... Args>
 	NodePtr<Type> __createNode(Args&&... args)
 	{
+		return __constructNode(args...);
+	}
+
+	template<typename ... Args>
+	NodePtr<Type> __constructNode(Args&&... args)
+	{
+		NodePtr<Type> node = NodeTraits::allocate(alloc_, 1);
+
+		try
+		{
+			NodeTraits::construct(alloc_, node, std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			NodeTraits::deallocate(alloc_, node, 1);
+			throw;
+		}
+
 		++length_;
-		return new Node<Type>(args...);
+		return node;
 	}
 
 	void __release(const NodePtr<Type> node)
 	{
 		--length_;
-		delete node;
+		NodeTraits::destroy(alloc_, node);
+		NodeTraits::deallocate(alloc_, node, 1);
 	}
 
 	NodePtr<Type> __find(Type const &data) const
 	{
 		NodePtr<Type> foundNode{nullptr};
 
-		for (NodePtr<Type> headTemp = head_, tailTemp = tail_; headTemp != tailTemp; headTemp = headTemp->next_, tailTemp = tailTemp->prev_)
+		for (NodePtr<Type> headTemp = head_, tailTemp = tail_; headTemp != nullptr; headTemp = headTemp->next_, tailTemp = tailTemp->prev_)
 		{
 			if (headTemp->data_ == data)
 			{
@@ -348,7 +692,8 @@ private:
 				break;
 			}
 
-			if (headTemp->next_ == tailTemp)
+			//Both ends met, on the same node or on neighbours
+			if (headTemp == tailTemp || headTemp->next_ == tailTemp)
 				break;
 		}
 
@@ -394,6 +739,92 @@ private:
 		__release(foundNode);
 	}
 
+	/**
+	 * Detaches the nodes first..last (inclusive) from this list, length_ is left to the caller
+	 */
+	void __unlink(const NodePtr<Type> first, const NodePtr<Type> last) noexcept
+	{
+		NodePtr<Type> const prev = first->prev_;
+		NodePtr<Type> const next = last->next_;
+
+		if (prev != nullptr)
+			prev->next_ = next;
+		else
+			head_ = next;
+
+		if (next != nullptr)
+			next->prev_ = prev;
+		else
+			tail_ = prev;
+
+		first->prev_ = nullptr;
+		last->next_ = nullptr;
+	}
+
+	/**
+	 * Links the detached nodes first..last (inclusive) before position, nullptr appends
+	 */
+	void __linkBefore(const NodePtr<Type> position, const NodePtr<Type> first, const NodePtr<Type> last) noexcept
+	{
+		NodePtr<Type> const prev = (position != nullptr ? position->prev_ : tail_);
+
+		first->prev_ = prev;
+		last->next_ = position;
+
+		if (prev != nullptr)
+			prev->next_ = first;
+		else
+			head_ = first;
+
+		if (position != nullptr)
+			position->prev_ = last;
+		else
+			tail_ = last;
+	}
+
+	/**
+	 * Merges two sorted next_ linked runs, nodes of first win ties
+	 */
+	template<typename Compare>
+	static NodePtr<Type> __merge(NodePtr<Type> first, NodePtr<Type> second, Compare &comp)
+	{
+		Node<Type> *head{nullptr};
+		NodePtr<Type> *link = &head;
+
+		while (first != nullptr && second != nullptr)
+		{
+			if (comp(second->data_, first->data_))
+			{
+				*link = second;
+				second = second->next_;
+			}
+			else
+			{
+				*link = first;
+				first = first->next_;
+			}
+
+			link = &(*link)->next_;
+		}
+
+		*link = (first != nullptr ? first : second);
+		return head;
+	}
+
+	/**
+	 * Rebuilds prev_ and tail_ from the next_ links starting at head
+	 */
+	void __relinkPrev(const NodePtr<Type> head) noexcept
+	{
+		head_ = head;
+		NodePtr<Type> prev{nullptr};
+
+		for (NodePtr<Type> node = head; node != nullptr; prev = node, node = node->next_)
+			node->prev_ = prev;
+
+		tail_ = prev;
+	}
+
 	void __addNodeAtFront(const NodePtr<Type> newNode)
 	{
 		if (empty())
@@ -418,12 +849,15 @@ private:
 		}
 	}
 
+	/**
+	 * Links newNode before position, nullptr position (end()) appends
+	 */
 	void __insert(const NodePtr<Type> position, const NodePtr<Type> newNode)
 	{
-		if (position == head_)
-			__addNodeAtFront(newNode);
-		else if (position == tail_)
+		if (position == nullptr)
 			__addNodeAtEnd(newNode);
+		else if (position == head_)
+			__addNodeAtFront(newNode);
 		else
 		{
 			auto parentPostion = position->prev_;
@@ -436,63 +870,71 @@ private:
 		}
 	}
 
+	NodeAllocator alloc_{};
 	NodePtr<Type> head_{nullptr};
 	NodePtr<Type> tail_{nullptr};
 	uint32_t length_{0};
 };
 
-template<typename Type>
-void List<Type>::insert(Iterator<Type> const &position, Type const &val, uint32_t const count)
+template<typename Type, typename Allocator>
+typename List<Type, Allocator>::iterator List<Type, Allocator>::insert(Iterator<Type> const &position, Type const &val, uint32_t const count)
 {
 	auto current = position.current_;
+	NodePtr<Type> first = current;
 
 	for (uint32_t i = 0; i < count; ++i)
 	{
 		auto newNode = __createNode(val);
 		__insert(current, newNode);
+
+		if (i == 0)
+			first = newNode;
 	}
+
+	return iterator(first);
 }
 
-template<typename Type>
+template<typename Type, typename Allocator>
 template<typename ... Args>
-void List<Type>::emplace(Iterator<Type> const &position, Args&&... args)
+typename List<Type, Allocator>::iterator List<Type, Allocator>::emplace(Iterator<Type> const &position, Args&&... args)
 {
 	auto newNode = __createNode(args...);
 	__insert(position.current_, newNode);
+	return iterator(newNode);
 }
 
-template<typename Type>
+template<typename Type, typename Allocator>
 template<typename ... Args>
-void List<Type>::emplace_back(Args&&... args)
+void List<Type, Allocator>::emplace_back(Args&&... args)
 {
 	auto newNode = __createNode(args...);
 	__addNodeAtEnd(newNode);
 }
 
-template<typename Type>
+template<typename Type, typename Allocator>
 template<typename ... Args>
-void List<Type>::emplace_front(Args&&... args)
+void List<Type, Allocator>::emplace_front(Args&&... args)
 {
 	auto newNode = __createNode(args...);
 	__addNodeAtFront(newNode);
 }
 
-template<typename Type>
-void List<Type>::push_back(Type const &data)
+template<typename Type, typename Allocator>
+void List<Type, Allocator>::push_back(Type const &data)
 {
 	auto newNode = __createNode(data);
 	__addNodeAtEnd(newNode);
 }
 
-template<typename Type>
-void List<Type>::push_front(Type const &data)
+template<typename Type, typename Allocator>
+void List<Type, Allocator>::push_front(Type const &data)
 {
 	auto newNode = __createNode(data);
 	__addNodeAtFront(newNode);
 }
 
-template<typename Type>
-void List<Type>::pop_back()
+template<typename Type, typename Allocator>
+void List<Type, Allocator>::pop_back()
 {
 	NodePtr<Type> node{nullptr};
 
@@ -508,11 +950,11 @@ void List<Type>::pop_back()
 		tail_->next_ = nullptr;
 	}
 
-	release(node);
+	__release(node);
 }
 
-template<typename Type>
-void List<Type>::pop_front()
+template<typename Type, typename Allocator>
+void List<Type, Allocator>::pop_front()
 {
 	NodePtr<Type> node{nullptr};
 
@@ -525,30 +967,2497 @@ void List<Type>::pop_front()
 	{
 		node = head_;
 		head_ = head_->next_;
-		head_->prev = nullptr;
+		head_->prev_ = nullptr;
 	}
 
-	release(node);
+	__release(node);
 }
 
-template<typename Type>
-uint32_t List<Type>::remove(Type const &data)
+/**
+ * Bottom up merge sort in one pass over the list: runs[i] holds a sorted run of
+ * 2^i nodes, every node is merged in like a binary counter increment. Runs in
+ * higher slots hold earlier nodes, so they are passed first to keep it stable.
+ */
+template<typename Type, typename Allocator>
+template<typename Compare>
+void List<Type, Allocator>::sort(Compare comp, SortStrategy strategy)
+{
+	if (length_ < 2)
+		return;
+
+	if (strategy == SortStrategy::PointerArray)
+	{
+		//Small trivially copyable values are copied next to their node pointer,
+		//comparisons then never leave the array
+		if constexpr (std::is_trivially_copyable_v<Type> && sizeof(Type) <= 16)
+		{
+			std::vector<std::pair<Type, NodePtr<Type>>> entries;
+			entries.reserve(length_);
+
+			for (NodePtr<Type> node = head_; node != nullptr; node = node->next_)
+				entries.emplace_back(node->data_, node);
+
+			std::stable_sort(entries.begin(), entries.end(), [&comp](auto const &lhs, auto const &rhs){
+				return comp(lhs.first, rhs.first);
+			});
+
+			for (uint32_t i = 0; i + 1 < length_; ++i)
+				entries[i].second->next_ = entries[i + 1].second;
+			entries[length_ - 1].second->next_ = nullptr;
+
+			__relinkPrev(entries[0].second);
+		}
+		else
+		{
+			std::vector<NodePtr<Type>> nodes;
+			nodes.reserve(length_);
+
+			for (NodePtr<Type> node = head_; node != nullptr; node = node->next_)
+				nodes.push_back(node);
+
+			std::stable_sort(nodes.begin(), nodes.end(), [&comp](NodePtr<Type> lhs, NodePtr<Type> rhs){
+				return comp(lhs->data_, rhs->data_);
+			});
+
+			for (uint32_t i = 0; i + 1 < length_; ++i)
+				nodes[i]->next_ = nodes[i + 1];
+			nodes[length_ - 1]->next_ = nullptr;
+
+			__relinkPrev(nodes[0]);
+		}
+
+		return;
+	}
+
+	NodePtr<Type> runs[33] = {};
+
+	for (NodePtr<Type> node = head_; node != nullptr; )
+	{
+		NodePtr<Type> carry = node;
+		node = node->next_;
+		carry->next_ = nullptr;
+
+		uint32_t i = 0;
+		for (; runs[i] != nullptr; ++i)
+		{
+			carry = __merge(runs[i], carry, comp);
+			runs[i] = nullptr;
+		}
+
+		runs[i] = carry;
+	}
+
+	NodePtr<Type> sorted{nullptr};
+	for (auto run: runs)
+		if (run != nullptr)
+			sorted = __merge(run, sorted, comp);
+
+	__relinkPrev(sorted);
+}
+
+template<typename Type, typename Allocator>
+uint32_t List<Type, Allocator>::remove(Type const &data)
 {
 	uint32_t count = 0;
-	for(auto node = __find(data); node != nullptr; __remove(node), ++count, node = __find(data));
+	NodePtr<Type> self{nullptr};
+
+	for (NodePtr<Type> node = head_; node != nullptr; )
+	{
+		NodePtr<Type> const next = node->next_;
+
+		if (node->data_ == data)
+		{
+			//data may be an element of this list, it is removed last
+			if (&node->data_ == &data)
+				self = node;
+			else
+				__remove(node);
+
+			++count;
+		}
+
+		node = next;
+	}
+
+	if (self != nullptr)
+		__remove(self);
+
 	return count;
 }
 
-template<typename Type>
-typename List<Type>::iterator List<Type>::find(Type const &data)
+template<typename Type, typename Allocator>
+typename List<Type, Allocator>::iterator List<Type, Allocator>::find(Type const &data)
 {
 	auto foundNode = __find(data);
 	return iterator(foundNode);
 }
 
-template<typename Type>
-typename List<Type>::const_iterator List<Type>::find(Type const &data) const
+template<typename Type, typename Allocator>
+typename List<Type, Allocator>::const_iterator List<Type, Allocator>::find(Type const &data) const
 {
 	auto foundNode = __find(data);
 	return const_iterator(foundNode);
 }
+
+template<typename Type, typename Allocator>
+typename List<Type, Allocator>::iterator List<Type, Allocator>::erase(iterator const &position)
+{
+	return erase(position, iterator(position.current_->next_));
+}
+
+template<typename Type, typename Allocator>
+typename List<Type, Allocator>::iterator List<Type, Allocator>::erase(iterator const &first, iterator const &last)
+{
+	if (first == last)
+		return last;
+
+	NodePtr<Type> const prev = first.current_->prev_;
+	NodePtr<Type> const next = last.current_;
+
+	for (NodePtr<Type> node = first.current_; node != next; )
+	{
+		NodePtr<Type> const erased = node;
+		node = node->next_;
+		__release(erased);
+	}
+
+	if (prev != nullptr)
+		prev->next_ = next;
+	else
+		head_ = next;
+
+	if (next != nullptr)
+		next->prev_ = prev;
+	else
+		tail_ = prev;
+
+	return last;
+}
+
+template<typename Type, typename Allocator>
+void List<Type, Allocator>::splice(iterator const &position, List &list) noexcept
+{
+	if (&list == this || list.head_ == nullptr)
+		return;
+
+	__linkBefore(position.current_, list.head_, list.tail_);
+	length_ += list.length_;
+
+	list.head_ = list.tail_ = nullptr;
+	list.length_ = 0;
+}
+
+template<typename Type, typename Allocator>
+void List<Type, Allocator>::splice(iterator const &position, List &list, iterator const &it) noexcept
+{
+	NodePtr<Type> const node = it.current_;
+
+	//Already in place
+	if (&list == this && (node == position.current_ || node->next_ == position.current_))
+		return;
+
+	list.__unlink(node, node);
+	--list.length_;
+
+	__linkBefore(position.current_, node, node);
+	++length_;
+}
+
+template<typename Type, typename Allocator>
+void List<Type, Allocator>::splice(iterator const &position, List &list, iterator const &first, iterator const &last) noexcept
+{
+	if (first == last)
+		return;
+
+	NodePtr<Type> const firstNode = first.current_;
+	NodePtr<Type> const lastNode = (last.current_ != nullptr ? last.current_->prev_ : list.tail_);
+
+	uint32_t count = 0;
+	if (&list != this)
+		for (NodePtr<Type> node = firstNode; node != last.current_; node = node->next_)
+			++count;
+
+	list.__unlink(firstNode, lastNode);
+	list.length_ -= count;
+
+	__linkBefore(position.current_, firstNode, lastNode);
+	length_ += count;
+}
+
+template<typename Type, typename Allocator>
+template<typename Compare>
+void List<Type, Allocator>::merge(List &list, Compare comp)
+{
+	if (&list == this || list.head_ == nullptr)
+		return;
+
+	__relinkPrev(__merge(head_, list.head_, comp));
+	length_ += list.length_;
+
+	list.head_ = list.tail_ = nullptr;
+	list.length_ = 0;
+}
+
+/**
+ * List with a side index from the hash of every element to the iterators of
+ * its nodes, kept up to date on every insert and removal. find, contains and
+ * count are O(1) average, remove is O(1) average per removed element instead
+ * of a scan of the list. The index costs one hash node (about 32 bytes) and a
+ * bucket per element, its nodes come from Allocator as well.
+ *
+ * List iterators survive splice and sort, so moving elements inside the list
+ * (to the front for an LRU) leaves the index untouched. Among equal elements
+ * find returns any one of them.
+ */
+template<typename Type, typename Hasher=std::hash<Type>, typename EqualTo=std::equal_to<Type>, typename Allocator=std::allocator<Type>>
+class IndexedList
+{
+	using ListType = List<Type, Allocator>;
+
+public:
+	using iterator = typename ListType::iterator;
+	using const_iterator = typename ListType::const_iterator;
+
+private:
+	//Keys are already hashes
+	struct IdentityHash
+	{
+		size_t operator()(size_t const hash) const noexcept
+		{
+			return hash;
+		}
+	};
+
+	using IndexAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const size_t, iterator>>;
+	using Index = std::unordered_multimap<size_t, iterator, IdentityHash, std::equal_to<size_t>, IndexAllocator>;
+
+public:
+	IndexedList() = default;
+
+	explicit IndexedList(Allocator const &alloc): list_(alloc), index_(0, IdentityHash{}, std::equal_to<size_t>{}, IndexAllocator(alloc))
+	{
+	}
+
+	IndexedList(IndexedList const &list): hasher_{list.hasher_}, equalTo_{list.equalTo_}
+	{
+		reserve(list.size());
+
+		for (auto const &ele: list)
+			push_back(ele);
+	}
+
+	IndexedList(IndexedList &&list) = default;
+
+	IndexedList & operator=(IndexedList const &list)
+	{
+		if (this != &list)
+		{
+			IndexedList anotherList(list);
+			swap(anotherList);
+		}
+
+		return *this;
+	}
+
+	IndexedList & operator=(IndexedList &&list) = default;
+
+	Allocator get_allocator() const
+	{
+		return list_.get_allocator();
+	}
+
+	void swap(IndexedList &list) noexcept
+	{
+		list_.swap(list.list_);
+		index_.swap(list.index_);
+		std::swap(hasher_, list.hasher_);
+		std::swap(equalTo_, list.equalTo_);
+	}
+
+	iterator begin() { return list_.begin(); }
+	iterator end() { return list_.end(); }
+	const_iterator begin() const { return list_.begin(); }
+	const_iterator end() const { return list_.end(); }
+
+	Type const & front() const noexcept { return list_.front(); }
+	Type const & back() const noexcept { return list_.back(); }
+
+	uint32_t size() const noexcept { return list_.size(); }
+	bool empty() const noexcept { return list_.empty(); }
+
+	/**
+	 * Makes room in the index for count elements without rehashing
+	 */
+	void reserve(uint32_t const count)
+	{
+		index_.reserve(count);
+	}
+
+	template<typename ... Args>
+	iterator emplace(iterator const &position, Args&&... args)
+	{
+		iterator itr = list_.emplace(position, std::forward<Args>(args)...);
+
+		try
+		{
+			index_.emplace(hasher_(*itr), itr);
+		}
+		catch (...)
+		{
+			list_.erase(itr);
+			throw;
+		}
+
+		return itr;
+	}
+
+	template<typename ... Args>
+	void emplace_back(Args&&... args)
+	{
+		emplace(list_.end(), std::forward<Args>(args)...);
+	}
+
+	template<typename ... Args>
+	void emplace_front(Args&&... args)
+	{
+		emplace(list_.begin(), std::forward<Args>(args)...);
+	}
+
+	iterator insert(iterator const &position, Type const &data) { return emplace(position, data); }
+	void push_back(Type const &data) { emplace(list_.end(), data); }
+	void push_front(Type const &data) { emplace(list_.begin(), data); }
+
+	void pop_front()
+	{
+		erase(list_.begin());
+	}
+
+	void pop_back()
+	{
+		__unindex(list_.back());
+		list_.pop_back();
+	}
+
+	/**
+	 * return: iterator to the element after the erased one
+	 */
+	iterator erase(iterator const &position)
+	{
+		iterator itr = position;
+		__unindex(*itr);
+		return list_.erase(position);
+	}
+
+	iterator find(Type const &data)
+	{
+		auto entry = __lookup(data);
+		return entry == index_.end() ? list_.end() : entry->second;
+	}
+
+	const_iterator find(Type const &data) const
+	{
+		auto entry = __lookup(data);
+		return entry == index_.end() ? list_.end() : const_iterator(entry->second);
+	}
+
+	bool contains(Type const &data) const
+	{
+		return __lookup(data) != index_.end();
+	}
+
+	uint32_t count(Type const &data) const
+	{
+		uint32_t count = 0;
+		auto range = index_.equal_range(hasher_(data));
+
+		for (auto entry = range.first; entry != range.second; ++entry)
+			count += equalTo_(__value(entry->second), data);
+
+		return count;
+	}
+
+	/**
+	 * Removes every element equal to data, return: removed count
+	 */
+	uint32_t remove(Type const &data)
+	{
+		uint32_t count = 0;
+		iterator self = list_.end();
+		auto range = index_.equal_range(hasher_(data));
+
+		for (auto entry = range.first; entry != range.second; )
+		{
+			iterator itr = entry->second;
+
+			if (! equalTo_(*itr, data))
+			{
+				++entry;
+				continue;
+			}
+
+			entry = index_.erase(entry);
+			++count;
+
+			//data may be an element of this list, it is removed last
+			if (&*itr == &data)
+				self = itr;
+			else
+				list_.erase(itr);
+		}
+
+		if (self != list_.end())
+			list_.erase(self);
+
+		return count;
+	}
+
+	/**
+	 * Moves the element at itr (or in [first, last)) of this list before position, O(1)
+	 */
+	void splice(iterator const &position, iterator const &itr) noexcept
+	{
+		list_.splice(position, list_, itr);
+	}
+
+	void splice(iterator const &position, iterator const &first, iterator const &last) noexcept
+	{
+		list_.splice(position, list_, first, last);
+	}
+
+	/**
+	 * Moves the element at itr of list before position, its index entry moves along
+	 */
+	void splice(iterator const &position, IndexedList &list, iterator const &itr)
+	{
+		if (&list == this)
+			return splice(position, itr);
+
+		iterator node = itr;
+		index_.emplace(hasher_(*node), node);
+		list.__unindex(*node);
+		list_.splice(position, list.list_, itr);
+	}
+
+	template<typename Compare=std::less<Type>>
+	void sort(Compare comp=Compare{}, SortStrategy strategy=SortStrategy::Relink)
+	{
+		list_.sort(comp, strategy);
+	}
+
+	void clear() noexcept
+	{
+		index_.clear();
+		list_.clear();
+	}
+
+private:
+	static Type const & __value(iterator itr)
+	{
+		return *itr;
+	}
+
+	typename Index::const_iterator __lookup(Type const &data) const
+	{
+		auto range = index_.equal_range(hasher_(data));
+
+		for (auto entry = range.first; entry != range.second; ++entry)
+			if (equalTo_(__value(entry->second), data))
+				return entry;
+
+		return index_.end();
+	}
+
+	/**
+	 * Drops the index entry of the element at address &element
+	 */
+	void __unindex(Type const &element)
+	{
+		auto range = index_.equal_range(hasher_(element));
+
+		for (auto entry = range.first; entry != range.second; ++entry)
+			if (&__value(entry->second) == &element)
+			{
+				index_.erase(entry);
+				return;
+			}
+	}
+
+	ListType list_;
+	Index index_;
+	Hasher hasher_{};
+	EqualTo equalTo_{};
+};
+
+/**
+ * Unrolled doubly linked list, every node (chunk) holds up to CAPACITY elements
+ * in an inline array, CAPACITY = ChunkBytes / sizeof(Type) and at least 1.
+ * Elements of a chunk are contiguous in [begin_, end_), push_back fills the tail
+ * chunk towards its end and push_front the head chunk towards its front, so both
+ * ends are O(1) and only every CAPACITY-th push allocates. Traversal and find
+ * scan arrays, one cache miss per chunk instead of one per element.
+ *
+ * Iterators stay valid across push/pop at both ends (except of popped elements)
+ * and across splice, which moves whole chunks. Insert and erase in the middle
+ * shift elements inside one chunk, a full chunk is split in half, which
+ * invalidates iterators into that chunk.
+ */
+template<typename Type, uint32_t ChunkBytes=64>
+class UnrolledList
+{
+	static constexpr uint32_t CAPACITY = (ChunkBytes / sizeof(Type) == 0 ? 1 : ChunkBytes / sizeof(Type));
+
+	struct Chunk
+	{
+		Chunk *prev_{nullptr}, *next_{nullptr};
+		uint32_t begin_{0}, end_{0};
+		alignas(Type) unsigned char storage_[CAPACITY * sizeof(Type)];
+
+		Type * data() noexcept
+		{
+			return reinterpret_cast<Type *>(storage_);
+		}
+
+		uint32_t size() const noexcept
+		{
+			return end_ - begin_;
+		}
+	};
+
+public:
+	template<typename Value>
+	class ChunkIterator
+	{
+	public:
+		using value_type = Type;
+		using pointer = Value *;
+		using reference = Value &;
+		using difference_type = ptrdiff_t;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		ChunkIterator() = default;
+
+		ChunkIterator(Chunk *chunk, uint32_t index, UnrolledList const *list): chunk_{chunk}, index_{index}, list_{list}
+		{
+		}
+
+		template<typename Other, typename = std::enable_if_t<std::is_const_v<Value> && !std::is_const_v<Other>>>
+		ChunkIterator(ChunkIterator<Other> const &itr): chunk_{itr.chunk_}, index_{itr.index_}, list_{itr.list_}
+		{
+		}
+
+		ChunkIterator & operator++()
+		{
+			if (++index_ == chunk_->end_)
+			{
+				chunk_ = chunk_->next_;
+				index_ = (chunk_ == nullptr ? 0 : chunk_->begin_);
+			}
+			return *this;
+		}
+
+		ChunkIterator operator++(int)
+		{
+			ChunkIterator tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		ChunkIterator & operator--()
+		{
+			if (chunk_ == nullptr)
+			{
+				chunk_ = list_->tail_;
+				index_ = chunk_->end_ - 1;
+			}
+			else if (index_ == chunk_->begin_)
+			{
+				chunk_ = chunk_->prev_;
+				index_ = chunk_->end_ - 1;
+			}
+			else
+				--index_;
+
+			return *this;
+		}
+
+		ChunkIterator operator--(int)
+		{
+			ChunkIterator tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		Value & operator*() const
+		{
+			return chunk_->data()[index_];
+		}
+
+		Value * operator->() const
+		{
+			return chunk_->data() + index_;
+		}
+
+		bool operator==(ChunkIterator const &itr) const
+		{
+			return chunk_ == itr.chunk_ && index_ == itr.index_;
+		}
+
+		bool operator!=(ChunkIterator const &itr) const
+		{
+			return ! (*this == itr);
+		}
+
+	private:
+		Chunk *chunk_{nullptr};
+		uint32_t index_{0};
+		UnrolledList const *list_{nullptr};
+
+		template<typename V>
+		friend class ChunkIterator;
+
+		friend class UnrolledList;
+	};
+
+	using iterator = ChunkIterator<Type>;
+	using const_iterator = ChunkIterator<const Type>;
+
+	UnrolledList() = default;
+
+	~UnrolledList()
+	{
+		clear();
+	}
+
+	UnrolledList(UnrolledList const &list)
+	{
+		for (auto const &ele: list)
+			push_back(ele);
+	}
+
+	UnrolledList(UnrolledList &&list) noexcept
+	{
+		swap(list);
+	}
+
+	UnrolledList & operator=(UnrolledList list) noexcept
+	{
+		swap(list);
+		return *this;
+	}
+
+	void swap(UnrolledList &list) noexcept
+	{
+		std::swap(list.head_, head_);
+		std::swap(list.tail_, tail_);
+		std::swap(list.length_, length_);
+	}
+
+	iterator begin() noexcept
+	{
+		return iterator(head_, head_ == nullptr ? 0 : head_->begin_, this);
+	}
+
+	iterator end() noexcept
+	{
+		return iterator(nullptr, 0, this);
+	}
+
+	const_iterator begin() const noexcept
+	{
+		return const_cast<UnrolledList *>(this)->begin();
+	}
+
+	const_iterator end() const noexcept
+	{
+		return const_cast<UnrolledList *>(this)->end();
+	}
+
+	template<typename ... Args>
+	void emplace_back(Args&&... args)
+	{
+		if (tail_ == nullptr || tail_->end_ == CAPACITY)
+			__linkAfter(tail_, __createChunk(0));
+
+		new (tail_->data() + tail_->end_) Type(std::forward<Args>(args)...);
+		++tail_->end_;
+		++length_;
+	}
+
+	template<typename ... Args>
+	void emplace_front(Args&&... args)
+	{
+		if (head_ == nullptr || head_->begin_ == 0)
+			__linkBefore(head_, __createChunk(CAPACITY));
+
+		new (head_->data() + head_->begin_ - 1) Type(std::forward<Args>(args)...);
+		--head_->begin_;
+		++length_;
+	}
+
+	void push_back(Type const &data)
+	{
+		emplace_back(data);
+	}
+
+	void push_front(Type const &data)
+	{
+		emplace_front(data);
+	}
+
+	void pop_back()
+	{
+		tail_->data()[--tail_->end_].~Type();
+		--length_;
+
+		if (tail_->size() == 0)
+			__unlinkAndRelease(tail_);
+	}
+
+	void pop_front()
+	{
+		head_->data()[head_->begin_++].~Type();
+		--length_;
+
+		if (head_->size() == 0)
+			__unlinkAndRelease(head_);
+	}
+
+	Type & front() noexcept { return head_->data()[head_->begin_]; }
+	Type & back() noexcept { return tail_->data()[tail_->end_ - 1]; }
+	Type const & front() const noexcept { return head_->data()[head_->begin_]; }
+	Type const & back() const noexcept { return tail_->data()[tail_->end_ - 1]; }
+
+	uint32_t size() const noexcept { return length_; }
+	bool empty() const noexcept { return length_ == 0; }
+
+	/**
+	 * Inserts data before position, return: iterator to the new element
+	 */
+	iterator insert(iterator position, Type const &data);
+
+	/**
+	 * return: iterator to the element after the erased one
+	 */
+	iterator erase(iterator position);
+
+	iterator find(Type const &data);
+	const_iterator find(Type const &data) const;
+
+	/**
+	 * Removes every element equal to data in one pass, return: removed count
+	 */
+	uint32_t remove(Type const &data);
+
+	/**
+	 * Moves all the chunks of list to the end of this list, O(1)
+	 */
+	void splice(UnrolledList &list) noexcept
+	{
+		if (list.head_ == nullptr)
+			return;
+
+		if (tail_ == nullptr)
+			head_ = list.head_;
+		else
+		{
+			tail_->next_ = list.head_;
+			list.head_->prev_ = tail_;
+		}
+
+		tail_ = list.tail_;
+		length_ += list.length_;
+
+		list.head_ = list.tail_ = nullptr;
+		list.length_ = 0;
+	}
+
+	void clear() noexcept
+	{
+		for (Chunk *chunk = head_; chunk != nullptr; )
+		{
+			Chunk *next = chunk->next_;
+			__destroy(chunk, chunk->begin_, chunk->end_);
+			delete chunk;
+			chunk = next;
+		}
+
+		head_ = tail_ = nullptr;
+		length_ = 0;
+	}
+
+private:
+	/**
+	 * Empty chunk whose elements start (and end) at index
+	 */
+	static Chunk * __createChunk(uint32_t const index)
+	{
+		Chunk *chunk = new Chunk;
+		chunk->begin_ = chunk->end_ = index;
+		return chunk;
+	}
+
+	static void __destroy(Chunk *chunk, uint32_t const first, uint32_t const last) noexcept
+	{
+		if constexpr (! std::is_trivially_destructible_v<Type>)
+		{
+			for (uint32_t i = first; i < last; ++i)
+				chunk->data()[i].~Type();
+		}
+	}
+
+	/**
+	 * Links chunk after position, position nullptr means the list is empty
+	 */
+	void __linkAfter(Chunk *position, Chunk *chunk) noexcept
+	{
+		if (position == nullptr)
+		{
+			head_ = tail_ = chunk;
+			return;
+		}
+
+		chunk->prev_ = position;
+		chunk->next_ = position->next_;
+
+		if (position->next_ != nullptr)
+			position->next_->prev_ = chunk;
+		else
+			tail_ = chunk;
+
+		position->next_ = chunk;
+	}
+
+	void __linkBefore(Chunk *position, Chunk *chunk) noexcept
+	{
+		if (position == nullptr || position->prev_ == nullptr)
+		{
+			if (position == nullptr)
+				head_ = tail_ = chunk;
+			else
+			{
+				chunk->next_ = position;
+				position->prev_ = chunk;
+				head_ = chunk;
+			}
+		}
+		else
+			__linkAfter(position->prev_, chunk);
+	}
+
+	void __unlinkAndRelease(Chunk *chunk) noexcept
+	{
+		if (chunk->prev_ != nullptr)
+			chunk->prev_->next_ = chunk->next_;
+		else
+			head_ = chunk->next_;
+
+		if (chunk->next_ != nullptr)
+			chunk->next_->prev_ = chunk->prev_;
+		else
+			tail_ = chunk->prev_;
+
+		delete chunk;
+	}
+
+	/**
+	 * Moves the upper half of a full chunk to a new chunk linked after it
+	 */
+	void __split(Chunk *chunk)
+	{
+		Chunk *upper = __createChunk(0);
+		uint32_t const middle = chunk->begin_ + chunk->size() / 2;
+
+		for (uint32_t i = middle; i < chunk->end_; ++i)
+		{
+			new (upper->data() + upper->end_++) Type(std::move(chunk->data()[i]));
+			chunk->data()[i].~Type();
+		}
+
+		chunk->end_ = middle;
+		__linkAfter(chunk, upper);
+	}
+
+	Chunk *head_{nullptr};
+	Chunk *tail_{nullptr};
+	uint32_t length_{0};
+};
+
+template<typename Type, uint32_t ChunkBytes>
+typename UnrolledList<Type, ChunkBytes>::iterator UnrolledList<Type, ChunkBytes>::insert(iterator position, Type const &data)
+{
+	if (position.chunk_ == nullptr)
+	{
+		push_back(data);
+		return iterator(tail_, tail_->end_ - 1, this);
+	}
+
+	Chunk *chunk = position.chunk_;
+	uint32_t index = position.index_;
+
+	if (chunk->size() == CAPACITY)
+	{
+		__split(chunk);
+
+		//The lower half always has room at its end, an insert right at the split appends to it
+		if (index > chunk->end_)
+		{
+			index = index - chunk->end_;
+			chunk = chunk->next_;
+		}
+	}
+
+	Type *slots = chunk->data();
+
+	if (chunk->end_ < CAPACITY)
+	{
+		//Shift [index, end_) one to the right
+		if (index == chunk->end_)
+			new (slots + index) Type(data);
+		else
+		{
+			new (slots + chunk->end_) Type(std::move(slots[chunk->end_ - 1]));
+			std::move_backward(slots + index, slots + chunk->end_ - 1, slots + chunk->end_);
+			slots[index] = data;
+		}
+
+		++chunk->end_;
+	}
+	else
+	{
+		//No room after the elements, shift [begin_, index) one to the left
+		if (index == chunk->begin_)
+			new (slots + index - 1) Type(data);
+		else
+		{
+			new (slots + chunk->begin_ - 1) Type(std::move(slots[chunk->begin_]));
+			std::move(slots + chunk->begin_ + 1, slots + index, slots + chunk->begin_);
+			slots[index - 1] = data;
+		}
+
+		--chunk->begin_;
+		--index;
+	}
+
+	++length_;
+	return iterator(chunk, index, this);
+}
+
+template<typename Type, uint32_t ChunkBytes>
+typename UnrolledList<Type, ChunkBytes>::iterator UnrolledList<Type, ChunkBytes>::erase(iterator position)
+{
+	Chunk *chunk = position.chunk_;
+	uint32_t const index = position.index_;
+	Type *data = chunk->data();
+
+	std::move(data + index + 1, data + chunk->end_, data + index);
+	data[--chunk->end_].~Type();
+	--length_;
+
+	if (index < chunk->end_)
+		return iterator(chunk, index, this);
+
+	Chunk *next = chunk->next_;
+
+	if (chunk->size() == 0)
+		__unlinkAndRelease(chunk);
+
+	return iterator(next, next == nullptr ? 0 : next->begin_, this);
+}
+
+template<typename Type, uint32_t ChunkBytes>
+typename UnrolledList<Type, ChunkBytes>::iterator UnrolledList<Type, ChunkBytes>::find(Type const &data)
+{
+	for (Chunk *chunk = head_; chunk != nullptr; chunk = chunk->next_)
+	{
+		Type *first = chunk->data() + chunk->begin_, *last = chunk->data() + chunk->end_;
+		Type *found = std::find(first, last, data);
+
+		if (found != last)
+			return iterator(chunk, found - chunk->data(), this);
+	}
+
+	return end();
+}
+
+template<typename Type, uint32_t ChunkBytes>
+typename UnrolledList<Type, ChunkBytes>::const_iterator UnrolledList<Type, ChunkBytes>::find(Type const &data) const
+{
+	return const_cast<UnrolledList *>(this)->find(data);
+}
+
+template<typename Type, uint32_t ChunkBytes>
+uint32_t UnrolledList<Type, ChunkBytes>::remove(Type const &data)
+{
+	uint32_t count = 0;
+
+	for (Chunk *chunk = head_; chunk != nullptr; )
+	{
+		Chunk *next = chunk->next_;
+		Type *first = chunk->data() + chunk->begin_, *last = chunk->data() + chunk->end_;
+		Type *kept = std::remove(first, last, data);
+		uint32_t const removed = last - kept;
+
+		__destroy(chunk, chunk->end_ - removed, chunk->end_);
+		chunk->end_ -= removed;
+		count += removed;
+
+		if (chunk->size() == 0)
+			__unlinkAndRelease(chunk);
+
+		chunk = next;
+	}
+
+	length_ -= count;
+	return count;
+}
+
+template<typename Type, typename Tag>
+class IntrusiveList;
+
+/**
+ * Links of an object on an IntrusiveList. The object derives from ListHook<Tag>
+ * once per list it can be on at the same time, Tag tells the hooks apart.
+ * Copies of a hook start unlinked, copying an object does not put the copy on
+ * the list of the original.
+ */
+template<typename Tag=void>
+class ListHook
+{
+public:
+	ListHook() = default;
+
+	ListHook(ListHook const &) noexcept
+	{
+	}
+
+	ListHook & operator=(ListHook const &) noexcept
+	{
+		return *this;
+	}
+
+	bool linked() const noexcept { return next_ != nullptr; }
+
+private:
+	template<typename, typename>
+	friend class IntrusiveList;
+
+	ListHook *prev_{nullptr}, *next_{nullptr};
+};
+
+/**
+ * Doubly linked list of objects the list does not own, the links live in the
+ * ListHook<Tag> base of Type. Linking and unlinking never allocates, unlink
+ * and iterator_to take only the object and are O(1). The list is circular
+ * around a sentinel hook, so end() is a real position and --end() is the last
+ * element.
+ *
+ * An object can be on one list per hook at a time and has to be unlinked
+ * before it is destroyed. Destroying the list unlinks all of its objects.
+ */
+template<typename Type, typename Tag=void>
+class IntrusiveList
+{
+	using Hook = ListHook<Tag>;
+
+	static_assert(std::is_base_of_v<Hook, Type>, "Type has to derive from ListHook<Tag>");
+
+public:
+	template<typename Value>
+	class HookIterator
+	{
+	public:
+		using value_type = Type;
+		using pointer = Value *;
+		using reference = Value &;
+		using difference_type = ptrdiff_t;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		HookIterator() = default;
+
+		explicit HookIterator(Hook *hook): hook_{hook}
+		{
+		}
+
+		template<typename Other, typename = std::enable_if_t<std::is_const_v<Value> && !std::is_const_v<Other>>>
+		HookIterator(HookIterator<Other> const &itr): hook_{itr.hook_}
+		{
+		}
+
+		HookIterator & operator++()
+		{
+			hook_ = hook_->next_;
+			return *this;
+		}
+
+		HookIterator operator++(int)
+		{
+			HookIterator tmp(*this);
+			hook_ = hook_->next_;
+			return tmp;
+		}
+
+		HookIterator & operator--()
+		{
+			hook_ = hook_->prev_;
+			return *this;
+		}
+
+		HookIterator operator--(int)
+		{
+			HookIterator tmp(*this);
+			hook_ = hook_->prev_;
+			return tmp;
+		}
+
+		Value & operator*() const
+		{
+			return static_cast<Type &>(*hook_);
+		}
+
+		Value * operator->() const
+		{
+			return &static_cast<Type &>(*hook_);
+		}
+
+		bool operator==(HookIterator const &itr) const
+		{
+			return hook_ == itr.hook_;
+		}
+
+		bool operator!=(HookIterator const &itr) const
+		{
+			return hook_ != itr.hook_;
+		}
+
+	private:
+		Hook *hook_{nullptr};
+
+		template<typename V>
+		friend class HookIterator;
+
+		friend class IntrusiveList;
+	};
+
+	using iterator = HookIterator<Type>;
+	using const_iterator = HookIterator<const Type>;
+
+	IntrusiveList() noexcept
+	{
+		root_.prev_ = root_.next_ = &root_;
+	}
+
+	~IntrusiveList()
+	{
+		clear();
+	}
+
+	IntrusiveList(IntrusiveList const &) = delete;
+	IntrusiveList & operator=(IntrusiveList const &) = delete;
+
+	IntrusiveList(IntrusiveList &&list) noexcept: IntrusiveList()
+	{
+		swap(list);
+	}
+
+	IntrusiveList & operator=(IntrusiveList &&list) noexcept
+	{
+		if (this != &list)
+		{
+			clear();
+			swap(list);
+		}
+
+		return *this;
+	}
+
+	/**
+	 * The neighbours of the sentinels point back at them, so they are relinked
+	 */
+	void swap(IntrusiveList &list) noexcept
+	{
+		std::swap(root_.prev_, list.root_.prev_);
+		std::swap(root_.next_, list.root_.next_);
+		std::swap(length_, list.length_);
+
+		__fixRoot();
+		list.__fixRoot();
+	}
+
+	iterator begin() noexcept { return iterator(root_.next_); }
+	iterator end() noexcept { return iterator(&root_); }
+
+	const_iterator begin() const noexcept { return const_cast<IntrusiveList *>(this)->begin(); }
+	const_iterator end() const noexcept { return const_cast<IntrusiveList *>(this)->end(); }
+
+	Type & front() noexcept { return static_cast<Type &>(*root_.next_); }
+	Type & back() noexcept { return static_cast<Type &>(*root_.prev_); }
+	Type const & front() const noexcept { return static_cast<Type const &>(*root_.next_); }
+	Type const & back() const noexcept { return static_cast<Type const &>(*root_.prev_); }
+
+	uint32_t size() const noexcept { return length_; }
+	bool empty() const noexcept { return length_ == 0; }
+
+	/**
+	 * Links object before position, object must not be linked, return: iterator to it
+	 */
+	iterator insert(iterator const &position, Type &object) noexcept
+	{
+		Hook *hook = &static_cast<Hook &>(object);
+		__linkBefore(position.hook_, hook);
+		++length_;
+		return iterator(hook);
+	}
+
+	void push_back(Type &object) noexcept { insert(end(), object); }
+	void push_front(Type &object) noexcept { insert(begin(), object); }
+
+	void pop_back() noexcept { unlink(back()); }
+	void pop_front() noexcept { unlink(front()); }
+
+	/**
+	 * Unlinks the object at position, return: iterator to the next one
+	 */
+	iterator erase(iterator const &position) noexcept
+	{
+		iterator next(position.hook_->next_);
+		unlink(*position);
+		return next;
+	}
+
+	/**
+	 * Unlinks object, which has to be on this list, O(1)
+	 */
+	void unlink(Type &object) noexcept
+	{
+		Hook *hook = &static_cast<Hook &>(object);
+
+		hook->prev_->next_ = hook->next_;
+		hook->next_->prev_ = hook->prev_;
+		hook->prev_ = hook->next_ = nullptr;
+		--length_;
+	}
+
+	/**
+	 * Iterator to object, which has to be on this list, O(1)
+	 */
+	iterator iterator_to(Type &object) noexcept
+	{
+		return iterator(&static_cast<Hook &>(object));
+	}
+
+	const_iterator iterator_to(Type const &object) const noexcept
+	{
+		return const_iterator(const_cast<Hook *>(&static_cast<Hook const &>(object)));
+	}
+
+	/**
+	 * Moves all objects of list before position, O(1)
+	 */
+	void splice(iterator const &position, IntrusiveList &list) noexcept
+	{
+		if (&list == this || list.empty())
+			return;
+
+		Hook *first = list.root_.next_, *last = list.root_.prev_;
+		Hook *next = position.hook_, *prev = next->prev_;
+
+		prev->next_ = first;
+		first->prev_ = prev;
+		last->next_ = next;
+		next->prev_ = last;
+
+		length_ += list.length_;
+
+		list.root_.prev_ = list.root_.next_ = &list.root_;
+		list.length_ = 0;
+	}
+
+	/**
+	 * Moves object (of list) before position, O(1)
+	 */
+	void splice(iterator const &position, IntrusiveList &list, Type &object) noexcept
+	{
+		Hook *hook = &static_cast<Hook &>(object);
+
+		if (hook == position.hook_ || hook->next_ == position.hook_)
+			return;
+
+		list.unlink(object);
+		insert(position, object);
+	}
+
+	/**
+	 * Unlinks all objects, O(n) as every hook is reset
+	 */
+	void clear() noexcept
+	{
+		for (Hook *hook = root_.next_; hook != &root_; )
+		{
+			Hook *next = hook->next_;
+			hook->prev_ = hook->next_ = nullptr;
+			hook = next;
+		}
+
+		root_.prev_ = root_.next_ = &root_;
+		length_ = 0;
+	}
+
+private:
+	void __linkBefore(Hook *position, Hook *hook) noexcept
+	{
+		Hook *prev = position->prev_;
+
+		hook->prev_ = prev;
+		hook->next_ = position;
+		prev->next_ = hook;
+		position->prev_ = hook;
+	}
+
+	void __fixRoot() noexcept
+	{
+		if (length_ == 0)
+			root_.prev_ = root_.next_ = &root_;
+		else
+		{
+			root_.next_->prev_ = &root_;
+			root_.prev_->next_ = &root_;
+		}
+	}
+
+	Hook root_;
+	uint32_t length_{0};
+};
+
+/**
+ * Lock-free doubly ended list, Michael's CAS based deque (Euro-Par 2003) with
+ * hazard pointers for memory reclamation. Any number of threads may push and
+ * pop at both ends concurrently.
+ *
+ * The anchor (leftmost node, rightmost node, status) is changed with a single
+ * 64 bit CAS, so nodes are addressed by 31 bit indices into segments that never
+ * move: segment s holds 1024 * 2^s nodes and is allocated on first use. A push
+ * links the new node to the anchor and marks the anchor unstable, whoever sees
+ * it unstable (the pusher itself or any other operation) completes the link of
+ * the old end node and marks it stable again.
+ *
+ * Popped nodes are retired to the hazard record of the popping operation and
+ * go to the free cache of that record once no record holds a hazard on them.
+ * Pushes allocate from the cache of their record, a cache over its limit hands
+ * the surplus to a shared free stack in one CAS, an empty cache takes the whole
+ * stack in one exchange. An operation leases a hazard record for its duration,
+ * a thread keeps using the record it leased last, records are added when all
+ * are taken. Node memory is returned when the list is destroyed.
+ */
+template<typename Type>
+class ConcurrentList
+{
+	struct Node
+	{
+		std::atomic<uint32_t> left_{0};
+		std::atomic<uint32_t> right_{0};
+		alignas(Type) unsigned char storage_[sizeof(Type)];
+
+		Type * data() noexcept
+		{
+			return reinterpret_cast<Type *>(storage_);
+		}
+	};
+
+	enum Status : uint64_t
+	{
+		Stable,
+		RightPush,
+		LeftPush
+	};
+
+	struct Anchor
+	{
+		uint32_t left_;
+		uint32_t right_;
+		Status status_;
+
+		uint64_t pack() const noexcept
+		{
+			return (uint64_t{left_} << 33) | (uint64_t{right_} << 2) | status_;
+		}
+
+		static Anchor unpack(uint64_t const word) noexcept
+		{
+			return Anchor{static_cast<uint32_t>(word >> 33), static_cast<uint32_t>(word >> 2) & INDEX_MASK, static_cast<Status>(word & 3)};
+		}
+	};
+
+	struct alignas(64) Record
+	{
+		std::atomic<bool> busy_{false};
+		std::atomic<uint32_t> hazards_[2]{};
+		std::vector<uint32_t> retired_;
+		std::vector<uint32_t> free_;
+		std::vector<uint32_t> scratch_;
+		Record *next_{nullptr};
+	};
+
+	static constexpr uint32_t INDEX_MASK = (1u << 31) - 1;
+	static constexpr uint32_t FIRST_SEGMENT_BITS = 10;
+	static constexpr uint32_t SEGMENTS = 22;
+	static constexpr uint32_t RETIRE_THRESHOLD = 64;
+	static constexpr uint32_t FREE_LIMIT = 256;
+
+public:
+	ConcurrentList() = default;
+
+	ConcurrentList(ConcurrentList const &) = delete;
+	ConcurrentList & operator=(ConcurrentList const &) = delete;
+
+	~ConcurrentList()
+	{
+		while (__popRight(nullptr));
+
+		for (Record *record = records_.load(std::memory_order_relaxed); record != nullptr; )
+		{
+			Record *next = record->next_;
+			delete record;
+			record = next;
+		}
+
+		for (auto &segment: segments_)
+			delete[] segment.load(std::memory_order_relaxed);
+	}
+
+	template<typename ... Args>
+	void emplace_back(Args&&... args)
+	{
+		Lease lease(*this);
+		__pushRight(lease, __createNode(lease, std::forward<Args>(args)...));
+	}
+
+	template<typename ... Args>
+	void emplace_front(Args&&... args)
+	{
+		Lease lease(*this);
+		__pushLeft(lease, __createNode(lease, std::forward<Args>(args)...));
+	}
+
+	void push_back(Type const &data) { emplace_back(data); }
+	void push_front(Type const &data) { emplace_front(data); }
+
+	/**
+	 * Moves the last / first element to data, return: false if the list was empty
+	 */
+	bool pop_back(Type &data) { return __popRight(&data); }
+	bool pop_front(Type &data) { return __popLeft(&data); }
+
+	bool empty() const noexcept
+	{
+		return Anchor::unpack(anchor_.load()).right_ == 0;
+	}
+
+private:
+	/**
+	 * Leases a hazard record for one operation, released by its destructor
+	 */
+	class Lease
+	{
+	public:
+		explicit Lease(ConcurrentList &list): list_{list}, record_{list.__acquire()}
+		{
+		}
+
+		~Lease()
+		{
+			for (uint32_t slot = 0; slot < 2; ++slot)
+				if (protected_ & (1u << slot))
+					record_->hazards_[slot].store(0, std::memory_order_release);
+
+			record_->busy_.store(false, std::memory_order_release);
+		}
+
+		Lease(Lease const &) = delete;
+		Lease & operator=(Lease const &) = delete;
+
+		/**
+		 * Publishes index as hazard number slot, the caller validates the anchor after it
+		 */
+		void protect(uint32_t const slot, uint32_t const index) noexcept
+		{
+			record_->hazards_[slot].store(index);
+			protected_ |= 1u << slot;
+		}
+
+		Record & record() noexcept { return *record_; }
+
+		void retire(uint32_t const index)
+		{
+			record_->retired_.push_back(index);
+
+			if (record_->retired_.size() >= RETIRE_THRESHOLD + 2 * list_.recordCount_.load(std::memory_order_relaxed))
+				list_.__scan(*record_);
+		}
+
+	private:
+		ConcurrentList &list_;
+		Record *record_;
+		uint32_t protected_{0};
+	};
+
+	Node & __node(uint32_t const index) const noexcept
+	{
+		uint64_t const block = (uint64_t{index} >> FIRST_SEGMENT_BITS) + 1;
+		uint32_t const segment = 63 - __builtin_clzll(block);
+		uint64_t const offset = index - (((uint64_t{1} << segment) - 1) << FIRST_SEGMENT_BITS);
+
+		return segments_[segment].load(std::memory_order_acquire)[offset];
+	}
+
+	template<typename ... Args>
+	uint32_t __createNode(Lease &lease, Args&&... args)
+	{
+		uint32_t const index = __allocate(lease.record());
+
+		try
+		{
+			new (__node(index).data()) Type(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			lease.record().free_.push_back(index);
+			throw;
+		}
+
+		return index;
+	}
+
+	uint32_t __allocate(Record &record)
+	{
+		auto &cache = record.free_;
+
+		//Only whole stacks are taken, so the shared stack has no ABA problem
+		if (cache.empty() && free_.load(std::memory_order_relaxed) != 0)
+			for (uint32_t index = free_.exchange(0, std::memory_order_acquire); index != 0; index = __node(index).right_.load(std::memory_order_relaxed))
+				cache.push_back(index);
+
+		if (! cache.empty())
+		{
+			uint32_t const index = cache.back();
+			cache.pop_back();
+			return index;
+		}
+
+		uint32_t const index = next_.fetch_add(1, std::memory_order_relaxed);
+		if (index > INDEX_MASK)
+			throw std::bad_alloc();
+
+		uint64_t const block = (uint64_t{index} >> FIRST_SEGMENT_BITS) + 1;
+		uint32_t const segment = 63 - __builtin_clzll(block);
+
+		if (segments_[segment].load(std::memory_order_acquire) == nullptr)
+		{
+			Node *nodes = new Node[size_t{1} << (segment + FIRST_SEGMENT_BITS)];
+			Node *expected{nullptr};
+
+			if (! segments_[segment].compare_exchange_strong(expected, nodes, std::memory_order_acq_rel))
+				delete[] nodes;
+		}
+
+		return index;
+	}
+
+	/**
+	 * Pushes the free cache of record beyond FREE_LIMIT / 2 to the shared stack as one chain
+	 */
+	void __spill(Record &record) noexcept
+	{
+		auto &cache = record.free_;
+		uint32_t const first = cache[FREE_LIMIT / 2];
+
+		for (size_t i = FREE_LIMIT / 2; i + 1 < cache.size(); ++i)
+			__node(cache[i]).right_.store(cache[i + 1], std::memory_order_relaxed);
+
+		std::atomic<uint32_t> &last = __node(cache.back()).right_;
+		uint32_t head = free_.load(std::memory_order_relaxed);
+
+		do
+		{
+			last.store(head, std::memory_order_relaxed);
+		}
+		while (! free_.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+
+		cache.resize(FREE_LIMIT / 2);
+	}
+
+	Record * __acquire()
+	{
+		thread_local uint64_t hintOwner{0};
+		thread_local Record *hint{nullptr};
+
+		if (hintOwner == id_ && ! hint->busy_.load(std::memory_order_relaxed) && ! hint->busy_.exchange(true, std::memory_order_acquire))
+			return hint;
+
+		Record *record = records_.load(std::memory_order_acquire);
+		for (; record != nullptr; record = record->next_)
+			if (! record->busy_.load(std::memory_order_relaxed) && ! record->busy_.exchange(true, std::memory_order_acquire))
+				break;
+
+		if (record == nullptr)
+		{
+			record = new Record;
+			record->busy_.store(true, std::memory_order_relaxed);
+			record->next_ = records_.load(std::memory_order_relaxed);
+
+			while (! records_.compare_exchange_weak(record->next_, record, std::memory_order_release, std::memory_order_relaxed));
+			recordCount_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		hintOwner = id_;
+		hint = record;
+		return record;
+	}
+
+	/**
+	 * Frees the retired nodes of record no record holds a hazard on
+	 */
+	void __scan(Record &record)
+	{
+		auto &hazards = record.scratch_;
+		hazards.clear();
+
+		for (Record *other = records_.load(std::memory_order_acquire); other != nullptr; other = other->next_)
+			for (auto &hazard: other->hazards_)
+				if (uint32_t const index = hazard.load(); index != 0)
+					hazards.push_back(index);
+
+		std::sort(hazards.begin(), hazards.end());
+
+		auto kept = std::partition(record.retired_.begin(), record.retired_.end(), [&hazards](uint32_t index){
+			return std::binary_search(hazards.begin(), hazards.end(), index);
+		});
+
+		record.free_.insert(record.free_.end(), kept, record.retired_.end());
+		record.retired_.erase(kept, record.retired_.end());
+
+		if (record.free_.size() > FREE_LIMIT)
+			__spill(record);
+	}
+
+	bool __casAnchor(Anchor const &expected, Anchor const &desired) noexcept
+	{
+		uint64_t word = expected.pack();
+		return anchor_.compare_exchange_strong(word, desired.pack());
+	}
+
+	bool __anchorIs(Anchor const &anchor) const noexcept
+	{
+		return anchor_.load() == anchor.pack();
+	}
+
+	void __pushRight(Lease &lease, uint32_t const index)
+	{
+		Node &node = __node(index);
+
+		for (;;)
+		{
+			Anchor const anchor = Anchor::unpack(anchor_.load());
+
+			if (anchor.right_ == 0)
+			{
+				if (__casAnchor(anchor, Anchor{index, index, Stable}))
+					return;
+			}
+			else if (anchor.status_ == Stable)
+			{
+				node.left_.store(anchor.right_, std::memory_order_relaxed);
+
+				Anchor const pushed{anchor.left_, index, RightPush};
+				if (__casAnchor(anchor, pushed))
+				{
+					__stabilizeRight(lease, pushed);
+					return;
+				}
+			}
+			else
+				__stabilize(lease, anchor);
+		}
+	}
+
+	void __pushLeft(Lease &lease, uint32_t const index)
+	{
+		Node &node = __node(index);
+
+		for (;;)
+		{
+			Anchor const anchor = Anchor::unpack(anchor_.load());
+
+			if (anchor.left_ == 0)
+			{
+				if (__casAnchor(anchor, Anchor{index, index, Stable}))
+					return;
+			}
+			else if (anchor.status_ == Stable)
+			{
+				node.right_.store(anchor.left_, std::memory_order_relaxed);
+
+				Anchor const pushed{index, anchor.right_, LeftPush};
+				if (__casAnchor(anchor, pushed))
+				{
+					__stabilizeLeft(lease, pushed);
+					return;
+				}
+			}
+			else
+				__stabilize(lease, anchor);
+		}
+	}
+
+	bool __popRight(Type *data)
+	{
+		Lease lease(*this);
+		Anchor anchor{};
+
+		for (;;)
+		{
+			anchor = Anchor::unpack(anchor_.load());
+
+			if (anchor.right_ == 0)
+				return false;
+
+			if (anchor.right_ == anchor.left_)
+			{
+				if (__casAnchor(anchor, Anchor{0, 0, anchor.status_}))
+					break;
+			}
+			else if (anchor.status_ == Stable)
+			{
+				lease.protect(0, anchor.right_);
+				if (! __anchorIs(anchor))
+					continue;
+
+				uint32_t const prev = __node(anchor.right_).left_.load(std::memory_order_acquire);
+				if (__casAnchor(anchor, Anchor{anchor.left_, prev, anchor.status_}))
+					break;
+			}
+			else
+				__stabilize(lease, anchor);
+		}
+
+		__release(lease, anchor.right_, data);
+		return true;
+	}
+
+	bool __popLeft(Type *data)
+	{
+		Lease lease(*this);
+		Anchor anchor{};
+
+		for (;;)
+		{
+			anchor = Anchor::unpack(anchor_.load());
+
+			if (anchor.left_ == 0)
+				return false;
+
+			if (anchor.right_ == anchor.left_)
+			{
+				if (__casAnchor(anchor, Anchor{0, 0, anchor.status_}))
+					break;
+			}
+			else if (anchor.status_ == Stable)
+			{
+				lease.protect(0, anchor.left_);
+				if (! __anchorIs(anchor))
+					continue;
+
+				uint32_t const next = __node(anchor.left_).right_.load(std::memory_order_acquire);
+				if (__casAnchor(anchor, Anchor{next, anchor.right_, anchor.status_}))
+					break;
+			}
+			else
+				__stabilize(lease, anchor);
+		}
+
+		__release(lease, anchor.left_, data);
+		return true;
+	}
+
+	/**
+	 * The popped node is owned by this operation, its links may still be read
+	 * by others until no hazard points at it
+	 */
+	void __release(Lease &lease, uint32_t const index, Type *data)
+	{
+		Type *element = __node(index).data();
+
+		if (data != nullptr)
+			*data = std::move(*element);
+		element->~Type();
+
+		lease.retire(index);
+	}
+
+	void __stabilize(Lease &lease, Anchor const &anchor)
+	{
+		if (anchor.status_ == RightPush)
+			__stabilizeRight(lease, anchor);
+		else
+			__stabilizeLeft(lease, anchor);
+	}
+
+	/**
+	 * Points right_ of the node before the pushed rightmost node at it and marks the anchor stable
+	 */
+	void __stabilizeRight(Lease &lease, Anchor const &anchor)
+	{
+		lease.protect(0, anchor.right_);
+		if (! __anchorIs(anchor))
+			return;
+
+		uint32_t const prev = __node(anchor.right_).left_.load(std::memory_order_acquire);
+		lease.protect(1, prev);
+		if (! __anchorIs(anchor))
+			return;
+
+		std::atomic<uint32_t> &prevNext = __node(prev).right_;
+		uint32_t next = prevNext.load(std::memory_order_acquire);
+
+		if (next != anchor.right_)
+		{
+			if (! __anchorIs(anchor))
+				return;
+			if (! prevNext.compare_exchange_strong(next, anchor.right_, std::memory_order_acq_rel))
+				return;
+		}
+
+		__casAnchor(anchor, Anchor{anchor.left_, anchor.right_, Stable});
+	}
+
+	void __stabilizeLeft(Lease &lease, Anchor const &anchor)
+	{
+		lease.protect(0, anchor.left_);
+		if (! __anchorIs(anchor))
+			return;
+
+		uint32_t const next = __node(anchor.left_).right_.load(std::memory_order_acquire);
+		lease.protect(1, next);
+		if (! __anchorIs(anchor))
+			return;
+
+		std::atomic<uint32_t> &nextPrev = __node(next).left_;
+		uint32_t prev = nextPrev.load(std::memory_order_acquire);
+
+		if (prev != anchor.left_)
+		{
+			if (! __anchorIs(anchor))
+				return;
+			if (! nextPrev.compare_exchange_strong(prev, anchor.left_, std::memory_order_acq_rel))
+				return;
+		}
+
+		__casAnchor(anchor, Anchor{anchor.left_, anchor.right_, Stable});
+	}
+
+	static inline std::atomic<uint64_t> nextId_{1};
+
+	uint64_t const id_{nextId_.fetch_add(1, std::memory_order_relaxed)};
+	alignas(64) std::atomic<uint64_t> anchor_{0};
+	alignas(64) std::atomic<uint32_t> free_{0};
+	std::atomic<uint32_t> next_{1};
+	alignas(64) std::atomic<Node *> segments_[SEGMENTS]{};
+	std::atomic<Record *> records_{nullptr};
+	std::atomic<uint32_t> recordCount_{0};
+};
+
+#include <chrono>
+#include <iomanip>
+#include <string>
+#include <list>
+#include <mutex>
+#include <random>
+#include <thread>
+
+template<typename F>
+double measureNs(uint64_t const operations, F &&func)
+{
+	auto const start = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+}
+
+/**
+ * push_back, full traversal, find of a missing value (scans everything) and
+ * pop_front, in ns per element
+ */
+template<typename ListType>
+void benchmarkList(std::string const &name, uint32_t const size)
+{
+	ListType list;
+	uint64_t sum = 0;
+
+	double const push = measureNs(size, [&]{
+		for (uint32_t i = 0; i < size; ++i)
+			list.push_back(static_cast<int>(i));
+	});
+
+	double const iterate = measureNs(size, [&]{
+		for (auto const &ele: list)
+			sum += ele;
+	});
+
+	double const find = measureNs(size, [&]{
+		sum += (list.find(-1) == list.end());
+	});
+
+	double const pop = measureNs(size, [&]{
+		while (! list.empty())
+			list.pop_front();
+	});
+
+	if (sum != uint64_t{size} * (size - 1) / 2 + 1)
+		std::cout << name << " wrong sum " << sum << std::endl;
+
+	std::cout << std::left << std::setw(12) << size << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << push << std::setw(12) << iterate << std::setw(12) << find << std::setw(12) << pop << std::endl;
+}
+
+/**
+ * Sorting size random ints, ns per element
+ */
+void benchmarkSort(uint32_t const size)
+{
+	std::mt19937 engine{size};
+	std::vector<int> values(size);
+
+	for (auto &value: values)
+		value = static_cast<int>(engine());
+
+	auto run = [&values](auto &&sort){
+		List<int> list;
+		for (auto value: values)
+			list.push_back(value);
+
+		double const ns = measureNs(values.size(), [&]{
+			sort(list);
+		});
+
+		if (! std::is_sorted(list.begin(), list.end()) || list.size() != values.size())
+			std::cout << "list is not sorted" << std::endl;
+
+		return ns;
+	};
+
+	double const relink = run([](List<int> &list){ list.sort(); });
+	double const pointerArray = run([](List<int> &list){ list.sort(std::less<int>{}, SortStrategy::PointerArray); });
+	double const typeErased = run([](List<int> &list){ list.sort(std::function<bool(int const &, int const &)>(std::less<int>{})); });
+
+	std::list<int> stdList(values.begin(), values.end());
+	double const stdSort = measureNs(values.size(), [&]{
+		stdList.sort();
+	});
+
+	std::cout << std::left << std::setw(12) << size << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << relink << std::setw(16) << pointerArray << std::setw(16) << typeErased << std::setw(16) << stdSort << std::endl;
+}
+
+/**
+ * Queue like use, ns per push_back + pop_front pair. Steady: the queue holds
+ * 1000 elements, every push is followed by a pop. Burst: the queue is filled
+ * with 64K elements and drained again.
+ */
+template<typename ListType>
+void benchmarkChurn(std::string const &name, uint32_t const operations)
+{
+	ListType list;
+	uint64_t sum = 0;
+
+	for (int i = 0; i < 1000; ++i)
+		list.push_back(i);
+
+	double const steady = measureNs(operations, [&]{
+		for (uint32_t i = 0; i < operations; ++i)
+		{
+			list.push_back(static_cast<int>(i));
+			sum += list.front();
+			list.pop_front();
+		}
+	});
+
+	list.clear();
+	uint32_t const burstSize = std::min<uint32_t>(operations, 64 * 1024);
+
+	double const burst = measureNs(operations / burstSize * burstSize, [&]{
+		for (uint32_t round = 0; round < operations / burstSize; ++round)
+		{
+			for (uint32_t i = 0; i < burstSize; ++i)
+				list.push_back(static_cast<int>(i));
+
+			while (! list.empty())
+			{
+				sum += list.front();
+				list.pop_front();
+			}
+		}
+	});
+
+	if (sum == 0)
+		std::cout << name << " wrong sum" << std::endl;
+
+	std::cout << std::left << std::setw(12) << operations << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << steady << std::setw(12) << burst << std::endl;
+}
+
+/**
+ * LRU move to front of a random entry (64 byte string payload), ns per move.
+ * Splice relinks the node, copy erases it and pushes a copy to the front.
+ */
+void benchmarkMoveToFront(uint32_t const size)
+{
+	using LruList = List<std::string, PoolAllocator<std::string>>;
+
+	std::mt19937 engine{size};
+	std::vector<uint32_t> picks(1000000);
+
+	for (auto &pick: picks)
+		pick = engine() % size;
+
+	LruList spliced, copied;
+	std::vector<LruList::iterator> splicedNodes, copiedNodes;
+
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		spliced.push_back(std::string(64, 'a' + i % 26));
+		copied.push_back(std::string(64, 'a' + i % 26));
+	}
+
+	for (auto itr = spliced.begin(); itr != spliced.end(); ++itr)
+		splicedNodes.push_back(itr);
+	for (auto itr = copied.begin(); itr != copied.end(); ++itr)
+		copiedNodes.push_back(itr);
+
+	double const splice = measureNs(picks.size(), [&]{
+		for (auto pick: picks)
+			spliced.splice(spliced.begin(), spliced, splicedNodes[pick]);
+	});
+
+	double const copy = measureNs(picks.size(), [&]{
+		for (auto pick: picks)
+		{
+			std::string const value = *copiedNodes[pick];
+			copied.erase(copiedNodes[pick]);
+			copied.push_front(value);
+			copiedNodes[pick] = copied.begin();
+		}
+	});
+
+	if (! std::equal(spliced.begin(), spliced.end(), copied.begin(), copied.end()))
+		std::cout << "move to front differs" << std::endl;
+
+	std::cout << std::left << std::setw(12) << size << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << splice << std::setw(16) << copy << std::endl;
+}
+
+struct Order: ListHook<>
+{
+	uint64_t id_{0};
+	double price_{0};
+};
+
+/**
+ * Removing a random object from a list of size objects and appending it again,
+ * ns per remove + push_back. List<Order *> searches the pointer with remove,
+ * IntrusiveList unlinks the object directly.
+ */
+void benchmarkUnlink(uint32_t const size)
+{
+	std::mt19937 engine{size};
+	std::vector<Order> orders(size);
+	std::vector<uint32_t> picks(std::max<uint32_t>(1000, 100000000 / size));
+
+	for (auto &pick: picks)
+		pick = engine() % size;
+
+	List<Order *, PoolAllocator<Order *>> pointers;
+	IntrusiveList<Order> intrusive;
+
+	for (auto &order: orders)
+	{
+		pointers.push_back(&order);
+		intrusive.push_back(order);
+	}
+
+	//A search scans half the list on average, fewer of them on big lists
+	uint32_t const searched = std::clamp<uint32_t>(100000000 / size, 100, 10000);
+	double const search = measureNs(searched, [&]{
+		for (uint32_t i = 0; i < searched; ++i)
+		{
+			pointers.remove(&orders[picks[i]]);
+			pointers.push_back(&orders[picks[i]]);
+		}
+	});
+
+	double const unlink = measureNs(picks.size(), [&]{
+		for (auto pick: picks)
+		{
+			intrusive.unlink(orders[pick]);
+			intrusive.push_back(orders[pick]);
+		}
+	});
+
+	if (pointers.size() != size || intrusive.size() != size)
+		std::cout << "unlink lost objects" << std::endl;
+
+	std::cout << std::left << std::setw(12) << size << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(16) << search << std::setw(16) << unlink << std::endl;
+}
+
+/**
+ * find of a random present value and remove + push_back of it, on lists of
+ * size distinct ints, ns per operation
+ */
+void benchmarkIndexed(uint32_t const size)
+{
+	std::mt19937 engine{size};
+	std::vector<int> picks(std::max<uint32_t>(1000, 10000000 / size));
+
+	for (auto &pick: picks)
+		pick = static_cast<int>(engine() % size);
+
+	List<int, PoolAllocator<int>> list;
+	IndexedList<int, std::hash<int>, std::equal_to<int>, PoolAllocator<int>> indexed;
+	indexed.reserve(size);
+
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		list.push_back(static_cast<int>(i));
+		indexed.push_back(static_cast<int>(i));
+	}
+
+	uint64_t sum = 0;
+	//A scan reads half the list on average, fewer of them on big lists
+	uint32_t const scanned = std::clamp<uint32_t>(100000000 / size, 100, picks.size());
+
+	double const listFind = measureNs(scanned, [&]{
+		for (uint32_t i = 0; i < scanned; ++i)
+			sum += *list.find(picks[i]);
+	});
+
+	double const indexedFind = measureNs(picks.size(), [&]{
+		for (auto pick: picks)
+			sum += *indexed.find(pick);
+	});
+
+	double const listRemove = measureNs(scanned, [&]{
+		for (uint32_t i = 0; i < scanned; ++i)
+		{
+			list.remove(picks[i]);
+			list.push_back(picks[i]);
+		}
+	});
+
+	double const indexedRemove = measureNs(picks.size(), [&]{
+		for (auto pick: picks)
+		{
+			indexed.remove(pick);
+			indexed.push_back(pick);
+		}
+	});
+
+	if (sum == 0 || list.size() != size || indexed.size() != size)
+		std::cout << "indexed lost elements" << std::endl;
+
+	std::cout << std::left << std::setw(12) << size << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(16) << listFind << std::setw(16) << indexedFind << std::setw(16) << listRemove << std::setw(16) << indexedRemove << std::endl;
+}
+
+/**
+ * List behind a std::mutex, the baseline of ConcurrentList
+ */
+template<typename Type>
+class LockedList
+{
+public:
+	void push_back(Type const &data)
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		list_.push_back(data);
+	}
+
+	void push_front(Type const &data)
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		list_.push_front(data);
+	}
+
+	bool pop_back(Type &data)
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		if (list_.empty())
+			return false;
+
+		data = list_.back();
+		list_.pop_back();
+		return true;
+	}
+
+	bool pop_front(Type &data)
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		if (list_.empty())
+			return false;
+
+		data = list_.front();
+		list_.pop_front();
+		return true;
+	}
+
+private:
+	std::mutex mutex_;
+	List<Type> list_;
+};
+
+/**
+ * threads threads sharing one list, ns per push or pop (wall time / all operations).
+ * Mixed: every thread pushes and pops in turn, even threads push_back/pop_front
+ * and odd ones push_front/pop_back. Split: half of the threads push_back, the
+ * other half pop_front until all elements are consumed.
+ */
+template<typename ListType>
+std::pair<double, double> benchmarkContention(uint32_t const threads, uint32_t const operations)
+{
+	uint32_t const perThread = operations / threads / 2;
+	std::vector<std::thread> workers;
+
+	ListType mixedList;
+	double const mixed = measureNs(uint64_t{perThread} * threads * 2, [&]{
+		for (uint32_t t = 0; t < threads; ++t)
+			workers.emplace_back([&mixedList, perThread, t]{
+				int data{0};
+				for (uint32_t i = 0; i < perThread; ++i)
+				{
+					if (t % 2 == 0)
+					{
+						mixedList.push_back(static_cast<int>(i));
+						mixedList.pop_front(data);
+					}
+					else
+					{
+						mixedList.push_front(static_cast<int>(i));
+						mixedList.pop_back(data);
+					}
+				}
+			});
+
+		for (auto &worker: workers)
+			worker.join();
+	});
+
+	workers.clear();
+
+	ListType splitList;
+	uint32_t const producers = std::max(1u, threads / 2);
+	double const split = measureNs(uint64_t{perThread} * producers * 4, [&]{
+		for (uint32_t t = 0; t < producers; ++t)
+			workers.emplace_back([&splitList, perThread]{
+				for (uint32_t i = 0; i < perThread * 2; ++i)
+					splitList.push_back(static_cast<int>(i));
+			});
+
+		for (uint32_t t = 0; t < producers; ++t)
+			workers.emplace_back([&splitList, perThread]{
+				int data{0};
+				for (uint32_t i = 0; i < perThread * 2; )
+					i += splitList.pop_front(data);
+			});
+
+		for (auto &worker: workers)
+			worker.join();
+	});
+
+	return {mixed, split};
+}
+
+void benchmarkConcurrent(uint32_t const threads, uint32_t const operations)
+{
+	auto const lockFree = benchmarkContention<ConcurrentList<int>>(threads, operations);
+	auto const locked = benchmarkContention<LockedList<int>>(threads, operations);
+
+	std::cout << std::left << std::setw(12) << threads << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(16) << lockFree.first << std::setw(16) << locked.first
+		<< std::setw(16) << lockFree.second << std::setw(16) << locked.second << std::endl;
+}
+
+void benchmark(uint32_t const maxSize)
+{
+	std::cout << std::left << std::setw(12) << "Elements" << std::setw(28) << "List<int>" << std::right
+		<< std::setw(12) << "Push(ns)" << std::setw(12) << "Iterate(ns)" << std::setw(12) << "Find(ns)" << std::setw(12) << "Pop(ns)" << std::endl;
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
+	{
+		benchmarkList<List<int>>("List", size);
+		benchmarkList<List<int, PoolAllocator<int>>>("List PoolAllocator", size);
+		benchmarkList<List<int, ArenaAllocator<int>>>("List ArenaAllocator", size);
+		benchmarkList<UnrolledList<int, 64>>("UnrolledList 64 bytes", size);
+		benchmarkList<UnrolledList<int, 256>>("UnrolledList 256 bytes", size);
+	}
+
+	std::cout << std::endl << std::left << std::setw(12) << "Sort" << std::right << std::setw(12) << "Relink(ns)"
+		<< std::setw(16) << "Pointers(ns)" << std::setw(16) << "Function(ns)" << std::setw(16) << "std::list(ns)" << std::endl;
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
+		benchmarkSort(size);
+
+	std::cout << std::endl << std::left << std::setw(12) << "Operations" << std::setw(28) << "Push + pop" << std::right
+		<< std::setw(12) << "Steady(ns)" << std::setw(12) << "Burst(ns)" << std::endl;
+
+	for (uint32_t size = 100000; size <= std::max(maxSize, 100000u) * 10; size *= 10)
+	{
+		benchmarkChurn<List<int>>("List", size);
+		benchmarkChurn<List<int, PoolAllocator<int>>>("List PoolAllocator", size);
+		benchmarkChurn<List<int, ArenaAllocator<int>>>("List ArenaAllocator", size);
+		benchmarkChurn<std::list<int>>("std::list", size);
+	}
+
+	std::cout << std::endl << std::left << std::setw(12) << "LRU" << std::right << std::setw(12) << "Splice(ns)"
+		<< std::setw(16) << "Copy(ns)" << std::endl;
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
+		benchmarkMoveToFront(size);
+
+	std::cout << std::endl << std::left << std::setw(12) << "Remove" << std::right << std::setw(16) << "Search(ns)"
+		<< std::setw(16) << "Intrusive(ns)" << std::endl;
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
+		benchmarkUnlink(size);
+
+	std::cout << std::endl << std::left << std::setw(12) << "Index" << std::right << std::setw(16) << "Find(ns)"
+		<< std::setw(16) << "Indexed(ns)" << std::setw(16) << "Remove(ns)" << std::setw(16) << "Indexed(ns)" << std::endl;
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
+		benchmarkIndexed(size);
+
+	std::cout << std::endl << std::left << std::setw(12) << "Threads" << std::right << std::setw(16) << "Mixed(ns)"
+		<< std::setw(16) << "Mutex(ns)" << std::setw(16) << "Split(ns)" << std::setw(16) << "Mutex(ns)" << std::endl;
+
+	for (uint32_t threads = 1; threads <= 8; threads *= 2)
+		benchmarkConcurrent(threads, std::max(maxSize, 1000000u) * 4);
+}
+
+template<typename ListType>
+void print(ListType const &list)
+{
+	for (auto const &ele: list)
+		cout << ele << " ";
+	cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	//./a.out --benchmark [max elements, default 1M]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		benchmark(argc > 2 ? std::stoul(argv[2]) : 1000000);
+		return 0;
+	}
+
+	List<int> list;
+	for (int i = 0; i < 5; ++i)
+		list.push_back(i);
+
+	list.push_front(-1);
+	list.insert(list.find(3), 42);
+	list.pop_back();
+	print(list);
+
+	list.sort(std::greater<int>{});
+	print(list);
+
+	ArenaAllocator<int> arena;
+	List<int, ArenaAllocator<int>> first(arena), second(arena);
+	for (int i = 0; i < 4; ++i)
+	{
+		first.push_back(i);
+		second.push_front(i);
+	}
+
+	first.pop_front();
+	second.pop_back();
+	print(first);
+	print(second);
+	cout << "arena bytes " << arena.arena().reserved() << endl;
+
+	first.splice(first.begin(), second, second.find(2));
+	first.splice(first.end(), second);
+	first.erase(first.begin(), first.find(3));
+	print(first);
+
+	List<int> odd, even;
+	for (int i = 0; i < 6; ++i)
+		(i % 2 ? odd : even).push_back(i);
+
+	odd.merge(even);
+	print(odd);
+
+	struct Connection: ListHook<>
+	{
+		int fd_;
+		explicit Connection(int fd): fd_{fd} {}
+	};
+
+	std::vector<Connection> connections;
+	for (int fd = 3; fd < 8; ++fd)
+		connections.emplace_back(fd);
+
+	IntrusiveList<Connection> idle;
+	for (auto &connection: connections)
+		idle.push_back(connection);
+
+	idle.unlink(connections[2]);
+	idle.splice(idle.begin(), idle, connections[4]);
+	for (auto const &connection: idle)
+		cout << connection.fd_ << " ";
+	cout << endl;
+
+	//LRU of capacity 3: a hit moves to the front, a miss evicts the back
+	IndexedList<int> lru;
+	for (int key: {1, 2, 3, 1, 4, 2})
+	{
+		auto itr = lru.find(key);
+		if (itr != lru.end())
+			lru.splice(lru.begin(), itr);
+		else
+		{
+			if (lru.size() == 3)
+				lru.pop_back();
+			lru.push_front(key);
+		}
+	}
+	print(lru);
+	cout << "contains 3: " << lru.contains(3) << endl;
+
+	ConcurrentList<int> shared;
+	std::thread producer([&shared]{
+		for (int i = 1; i <= 1000; ++i)
+			shared.push_back(i);
+	});
+
+	long consumed = 0;
+	for (int popped = 0, data = 0; popped < 1000; )
+		if (shared.pop_front(data))
+		{
+			consumed += data;
+			++popped;
+		}
+
+	producer.join();
+	cout << "consumed " << consumed << endl;
+
+	UnrolledList<int, 16> unrolled;
+	for (int i = 0; i < 10; ++i)
+		unrolled.push_back(i);
+
+	unrolled.push_front(-1);
+	unrolled.insert(unrolled.find(5), 42);
+	unrolled.erase(unrolled.find(7));
+	unrolled.remove(2);
+	unrolled.pop_back();
+	print(unrolled);
+
+	return 0;
+}
@@ -1,70 +1,215 @@
 #include <atomic>
-#include <array>
+#include <new>
+#include <sys/mman.h>
 
 using namespace std;
 
-template<typename ElementType, size_t SIZE>
+/**
+ * Single producer single consumer queue. Producer and consumer state live on
+ * separate cache lines, each side keeps a copy of the other side's index and
+ * reads the shared one only when its copy says the queue is full (producer) or
+ * empty (consumer).
+ *
+ * Head and tail run freely and are mapped to a slot when used, all SIZE slots
+ * hold items and the queue is full when tail - head == SIZE. A power of two SIZE
+ * maps with a mask, any other SIZE with a division (and wraps wrongly after 2^64
+ * items).
+ *
+ * The slots are allocated on the heap, with use_huge_pages from a MAP_HUGETLB
+ * mapping of 2MB pages if the system has them reserved, else from an anonymous
+ * mapping advised as transparent huge pages.
+ *
+ * PUBLISH_BATCH: pushed items become visible to the consumer every PUBLISH_BATCH
+ * pushes, when the queue is full, or on flush(). 1 publishes every push.
+ */
+template<typename ElementType, size_t SIZE, size_t PUBLISH_BATCH = 1>
 class CircularQueue
 {
+	static_assert(SIZE >= 1, "SIZE has to be at least 1");
+	static_assert(PUBLISH_BATCH >= 1, "PUBLISH_BATCH has to be at least 1");
+
 public:
-	CircularQueue(): queue_tail{0}, queue_head{0}
+	explicit CircularQueue(bool use_huge_pages = false): queue_tail{0}, queue_head{0}
+	{
+		allocate_storage(use_huge_pages);
+
+		size_t constructed = 0;
+
+		try
+		{
+			for (; constructed < SIZE; ++constructed)
+				new (queue + constructed) ElementType();
+		}
+		catch (...)
+		{
+			destroy_storage(constructed);
+			throw;
+		}
+	}
+
+	~CircularQueue()
 	{
+		destroy_storage(SIZE);
 	}
 
+	CircularQueue(CircularQueue const &) = delete;
+	CircularQueue & operator=(CircularQueue const &) = delete;
+
 	bool push(const ElementType& item);
 
 	bool pop(ElementType& item);
 
+	//Publishes the items pushed since the last publication, producer side
+	void flush()
+	{
+		if (unpublished != 0)
+		{
+			queue_tail.store(write_tail, std::memory_order_release);
+			unpublished = 0;
+		}
+	}
+
+	//Consumer side, unpublished items are not seen
 	bool is_empty() const
 	{
 		return (queue_head.load(std::memory_order_acquire) == queue_tail.load(std::memory_order_acquire));
 	}
 
+	//Producer side
 	bool is_full() const
 	{
-		const auto next_tail = increment(queue_tail.load(std::memory_order_acquire));
-		return (next_tail == queue_head.load(std::memory_order_acquire));
+		return (write_tail - queue_head.load(std::memory_order_acquire) == SIZE);
+	}
+
+	//Storage is backed by a huge page mapping or advised as transparent huge pages
+	bool huge_pages() const
+	{
+		return storage_kind != Storage::Heap;
 	}
 
 private:
-	size_t increment(size_t index) const
+	enum class Storage
 	{
-		return (index + 1) % QUEUE_CAPACITY;
+		Heap,
+		HugeTlb,
+		Transparent
+	};
+
+	size_t slot(size_t index) const
+	{
+		if constexpr (POWER_OF_TWO)
+			return index & (SIZE - 1);
+		else
+			return index % SIZE;
 	}
 
-	inline static constexpr size_t QUEUE_CAPACITY = SIZE + 1;
+	void allocate_storage(bool use_huge_pages)
+	{
+		if (use_huge_pages)
+		{
+			mapped_bytes = (SIZE * sizeof(ElementType) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+			//Page size is requested explicitly, the default huge page size may differ (e.g. 512MB on arm64 with 64KB pages)
+			void *memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (HUGE_PAGE_SHIFT << MAP_HUGE_SHIFT), -1, 0);
+			storage_kind = Storage::HugeTlb;
+
+			if (memory == MAP_FAILED)
+			{
+				memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				storage_kind = Storage::Transparent;
+
+				if (memory == MAP_FAILED)
+					throw std::bad_alloc();
+
+				if (madvise(memory, mapped_bytes, MADV_HUGEPAGE) != 0)
+					storage_kind = Storage::Heap;
+			}
+
+			//Mapped memory is released with munmap whatever madvise said
+			queue = static_cast<ElementType *>(memory);
+			mapped = true;
+			return;
+		}
+
+		queue = static_cast<ElementType *>(::operator new(SIZE * sizeof(ElementType), std::align_val_t(STORAGE_ALIGNMENT)));
+	}
+
+	void destroy_storage(size_t constructed)
+	{
+		for (size_t i = 0; i < constructed; ++i)
+			queue[i].~ElementType();
+
+		if (mapped)
+			munmap(queue, mapped_bytes);
+		else
+			::operator delete(queue, std::align_val_t(STORAGE_ALIGNMENT));
+	}
+
+	inline static constexpr bool POWER_OF_TWO = (SIZE & (SIZE - 1)) == 0;
+	inline static constexpr size_t CACHELINE_SIZE = 64;
+	inline static constexpr int HUGE_PAGE_SHIFT = 21;
+	inline static constexpr size_t HUGE_PAGE_SIZE = size_t{1} << HUGE_PAGE_SHIFT;
+	inline static constexpr size_t STORAGE_ALIGNMENT = alignof(ElementType) > CACHELINE_SIZE ? alignof(ElementType) : CACHELINE_SIZE;
+
+	//Producer: published tail, next slot to write and copy of the consumer's head
+	alignas(CACHELINE_SIZE) std::atomic<size_t> queue_tail;
+	size_t write_tail{0};
+	size_t cached_head{0};
+	size_t unpublished{0};
 
-	std::atomic<size_t> queue_head, queue_tail;
-	array<ElementType, QUEUE_CAPACITY> queue;
+	//Consumer: head and copy of the published tail
+	alignas(CACHELINE_SIZE) std::atomic<size_t> queue_head;
+	size_t cached_tail{0};
+
+	//Read by both sides, never written after construction
+	alignas(CACHELINE_SIZE) ElementType *queue{nullptr};
+	size_t mapped_bytes{0};
+	bool mapped{false};
+	Storage storage_kind{Storage::Heap};
 };
 
-template<typename ElementType, size_t SIZE>
-bool CircularQueue<ElementType, SIZE>::push(const ElementType& item)
+template<typename ElementType, size_t SIZE, size_t PUBLISH_BATCH>
+bool CircularQueue<ElementType, SIZE, PUBLISH_BATCH>::push(const ElementType& item)
 {
-	const auto current_tail = queue_tail.load(std::memory_order_relaxed);
-	const auto next_tail = increment(current_tail);
+	const auto current_tail = write_tail;
 
-	if (next_tail != queue_head.load(std::memory_order_acquire))
+	if (current_tail - cached_head == SIZE)
 	{
-		queue[current_tail] = item;
-		queue_tail.store(next_tail, std::memory_order_release);
-		return true;
+		cached_head = queue_head.load(std::memory_order_acquire);
+
+		if (current_tail - cached_head == SIZE)
+		{
+			//Full, the consumer has to see everything to make room
+			flush();
+			return false;
+		}
 	}
 
-	return false;
+	queue[slot(current_tail)] = item;
+	write_tail = current_tail + 1;
+
+	if (++unpublished == PUBLISH_BATCH)
+		flush();
+
+	return true;
 }
 
-template<typename ElementType, size_t SIZE>
-bool CircularQueue<ElementType, SIZE>::pop(ElementType& item)
+template<typename ElementType, size_t SIZE, size_t PUBLISH_BATCH>
+bool CircularQueue<ElementType, SIZE, PUBLISH_BATCH>::pop(ElementType& item)
 {
 	const auto current_head = queue_head.load(std::memory_order_relaxed);
 
-	if (current_head == queue_tail.load(std::memory_order_acquire))
-		return false;
+	if (current_head == cached_tail)
+	{
+		cached_tail = queue_tail.load(std::memory_order_acquire);
+
+		if (current_head == cached_tail)
+			return false;
+	}
 
-	item = queue[current_head];
+	item = queue[slot(current_head)];
 
-	queue_head.store(increment(current_head), std::memory_order_release);
+	queue_head.store(current_head + 1, std::memory_order_release);
 
 	return true;
 }
@@ -73,6 +218,9 @@ bool CircularQueue<ElementType, SIZE>::pop(ElementType& item)
 #include <mutex>
 #include <string>
 #include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
 
 using namespace std;
 
@@ -109,8 +257,96 @@ void pop(CircularQueue<int, 1024*1024> &queue)
 	}
 }
 
-int main()
+/**
+ * One producer thread pushes operations ints, one consumer pops them, both yield
+ * while the queue is full / empty (a spinning thread would hold a shared core for
+ * its whole time slice). The queue is created (and its storage allocated) inside
+ * the measurement. Return: items per second
+ */
+template<typename Queue>
+double measureThroughput(uint64_t const operations, bool use_huge_pages = false, bool *huge_pages = nullptr)
+{
+	auto const start = std::chrono::steady_clock::now();
+
+	auto queue = std::make_unique<Queue>(use_huge_pages);
+	uint64_t sum = 0;
+
+	if (huge_pages != nullptr)
+		*huge_pages = queue->huge_pages();
+
+	std::thread producer{[&queue, operations]{
+		for (uint64_t i = 1; i <= operations; ++i)
+			while (! queue->push(static_cast<int>(i)))
+				std::this_thread::yield();
+
+		queue->flush();
+	}};
+
+	std::thread consumer{[&queue, &sum, operations]{
+		int data{0};
+
+		for (uint64_t i = 1; i <= operations; ++i)
+		{
+			while (! queue->pop(data))
+				std::this_thread::yield();
+			sum += data;
+		}
+	}};
+
+	producer.join();
+	consumer.join();
+
+	double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t expected = 0;
+	for (uint64_t i = 1; i <= operations; ++i)
+		expected += static_cast<int>(i);
+
+	if (sum != expected)
+		cout << "lost items, sum " << sum << " expected " << expected << endl;
+
+	return operations / seconds;
+}
+
+template<size_t SIZE, size_t PUBLISH_BATCH>
+void benchmarkQueue(uint64_t const operations, bool use_huge_pages = false)
 {
+	bool huge_pages = false;
+	double const opsPerSec = measureThroughput<CircularQueue<int, SIZE, PUBLISH_BATCH>>(operations, use_huge_pages, &huge_pages);
+
+	cout << std::left << std::setw(12) << SIZE << std::setw(12) << PUBLISH_BATCH << std::setw(12) << (huge_pages ? "yes" : "no")
+		<< std::right << std::fixed << std::setprecision(0) << std::setw(16) << opsPerSec << endl;
+}
+
+void benchmark(uint64_t const operations)
+{
+	cout << std::left << std::setw(12) << "Size" << std::setw(12) << "Batch" << std::setw(12) << "Huge pages"
+		<< std::right << std::setw(16) << "Ops/sec" << endl;
+
+	//Power of two sizes mask, the others divide
+	benchmarkQueue<1000, 1>(operations);
+	benchmarkQueue<1024, 1>(operations);
+	benchmarkQueue<1024, 8>(operations);
+	benchmarkQueue<1024, 64>(operations);
+	benchmarkQueue<64000, 1>(operations);
+	benchmarkQueue<64 * 1024, 1>(operations);
+	benchmarkQueue<64 * 1024, 8>(operations);
+	benchmarkQueue<64 * 1024, 64>(operations);
+
+	//64MB of slots, all touched by the constructor which value initializes them
+	benchmarkQueue<16 * 1024 * 1024, 1>(operations);
+	benchmarkQueue<16 * 1024 * 1024, 1>(operations, true);
+}
+
+int main(int argc, char *argv[])
+{
+	//./a.out --benchmark [operations, default 100M]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		benchmark(argc > 2 ? std::stoull(argv[2]) : 100000000);
+		return 0;
+	}
+
 	CircularQueue<int, 1024*1024> queue;
 
 	std::thread t1{push, std::ref(queue)};
@@ -148,6 +148,79 @@ std::ostream& operator<<(std::ostream &out, std::tuple<TypeN...> const& theTuple
 #include <functional>
 #include <atomic>
 #include <future>
+#include <memory>
+#include <random>
+#include <cmath>
+#include <stdexcept>
+
+class TaskCancelled: public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+/**
+ * Read only view of a cancellation request. Tasks receive a token and
+ * should poll stopRequested() at convenient points to stop early.
+ * Copying a token is cheap, all the copies share the same state.
+ */
+class StopToken
+{
+public:
+	StopToken() = default;
+
+	bool stopRequested() const noexcept
+	{
+		return state_ != nullptr && state_->load(std::memory_order_acquire);
+	}
+
+	bool stopPossible() const noexcept
+	{
+		return state_ != nullptr;
+	}
+
+private:
+	friend class StopSource;
+
+	explicit StopToken(std::shared_ptr<std::atomic<bool>> state): state_{std::move(state)}
+	{
+	}
+
+	std::shared_ptr<std::atomic<bool>> state_;
+};
+
+/**
+ * Owner side of a cancellation request. One source can hand out tokens
+ * to any number of tasks and cancel all of them with requestStop().
+ */
+class StopSource
+{
+public:
+	StopSource(): state_{std::make_shared<std::atomic<bool>>(false)}
+	{
+	}
+
+	StopToken token() const noexcept
+	{
+		return StopToken(state_);
+	}
+
+	/**
+	 * return: true if this call changed the state, false if stop was already requested
+	 */
+	bool requestStop() noexcept
+	{
+		return ! state_->exchange(true, std::memory_order_acq_rel);
+	}
+
+	bool stopRequested() const noexcept
+	{
+		return state_->load(std::memory_order_acquire);
+	}
+
+private:
+	std::shared_ptr<std::atomic<bool>> state_;
+};
 
 
 /**
@@ -157,6 +230,10 @@ std::ostream& operator<<(std::ostream &out, std::tuple<TypeN...> const& theTuple
  *
  * Once threadpool is shutdown, submitted tasks will not
  * be scheduled.
+ *
+ * Tasks submitted with a StopToken are skipped if the token is
+ * stopped before a worker picks them up, so cancelling a queued
+ * task is O(1) and never touches the queue.
  */
 class ThreadPool
 {
@@ -271,6 +348,69 @@ public:
 		return future;
 	}
 
+	/**
+	 * token: Task is discarded without running if stop is requested before it starts
+	 * function: Task to be schduled, invoked as func(token). Long running tasks should
+	 * poll token.stopRequested() and return early
+	 * createNewIfReq: Add a new thread when total queued tasks are greater than threadpool size
+	 */
+	template <typename F>
+	void submitCancellableTask(StopToken const &token, F &&func, const bool createNewIfReq=false)
+	{
+		submitTask([token, func = std::forward<F>(func)]() mutable
+			{
+				if (! token.stopRequested())
+					func(token);
+			},
+			createNewIfReq
+		);
+	}
+
+	/**
+	 * token: Task is discarded without running if stop is requested before it starts
+	 * function: Task to be schduled, invoked as func(token, args...)
+	 * createNewIfReq: Add a new thread when total queued tasks are greater than threadpool size
+	 * return: std::future. If the task is cancelled before it starts, std::future<TYPE>::get()
+	 * throws TaskCancelled. Same blocking rules as submitTask(createNewIfReq, func, args...)
+	 */
+	template <typename F, typename... A, typename R = std::invoke_result_t<std::decay_t<F>, StopToken const &, std::decay_t<A>...>>
+	std::future<R> submitCancellableTask(const bool createNewIfReq, StopToken const &token, const F &func, const A &...args)
+	{
+		std::shared_ptr<std::promise<R>> task_promise(new std::promise<R>);
+		std::future<R> future = task_promise->get_future();
+
+		submitTask([token, func, args..., task_promise]
+			{
+				try
+				{
+					if (token.stopRequested())
+						throw TaskCancelled("Task cancelled before it was started");
+
+					if constexpr (std::is_void_v<R>)
+					{
+						func(token, args...);
+						task_promise->set_value();
+					}
+					else
+						task_promise->set_value(func(token, args...));
+				}
+				catch (...)
+				{
+					try
+					{
+						task_promise->set_exception(std::current_exception());
+					}
+					catch (...)
+					{
+					}
+				}
+			},
+			createNewIfReq
+		);
+
+		return future;
+	}
+
 	uint32_t threads() const
 	{
 		return count_;
@@ -288,8 +428,33 @@ public:
 	void shutdown()
 	{
 		LOG("Shutting down threadpool");
-		startFlag_.store(false, std::memory_order_release);
+		{
+			std::unique_lock<std::mutex> lock{mt_};
+			startFlag_.store(false, std::memory_order_release);
+		}
+		cv_.notify_all();
+	}
+
+	/**
+	 * Shutdown threadpool and discard all the tasks which are not started yet.
+	 * Running tasks are not interrupted, cancel their StopSource to stop them early.
+	 * Futures of discarded tasks report std::future_errc::broken_promise.
+	 * return: Number of discarded tasks
+	 */
+	uint32_t shutdownNow()
+	{
+		LOG("Shutting down threadpool now");
+
+		std::deque<std::function<void()>> pending;
+		{
+			std::unique_lock<std::mutex> lock{mt_};
+			startFlag_.store(false, std::memory_order_release);
+			pending.swap(queue_);
+		}
 		cv_.notify_all();
+
+		LOG("Discarded pending tasks: " << pending.size());
+		return pending.size();
 	}
 
 	void waitForPendingTasks()
@@ -307,9 +472,12 @@ private:
 		{
 			std::unique_lock<std::mutex> lock{mt_};
 			cv_.wait(lock, [&](){
-				return (! queue_.empty());
+				return (! queue_.empty()) || (! startFlag_.load(std::memory_order_acquire));
 			});
 
+			if (queue_.empty())
+				break;
+
 			auto task = std::move(queue_.front());
 			queue_.pop_front();
 
@@ -327,8 +495,530 @@ private:
 	std::condition_variable cv_;
 };
 
-int main()
+/**
+ * Task graph (DAG) executed on ThreadPool.
+ * Graph is built once with addTask() and precede() and can be executed many times.
+ * Each node keeps an atomic counter of unfinished predecessors, the predecessor
+ * which brings it to zero submits it to the pool, so no thread blocks on futures.
+ *
+ * run() blocks the caller until every node has finished, don't call it from a
+ * threadpool task. Only one run() of a graph can be in progress at a time and
+ * the threadpool must not be shutdown while graph is running.
+ * Nodes state is allocated while building, a run only allocates when the
+ * threadpool queue grows to hold the ready nodes.
+ */
+class TaskGraph
 {
+public:
+	using NodeId = uint32_t;
+
+	TaskGraph() = default;
+	TaskGraph(TaskGraph const &) = delete;
+	TaskGraph & operator=(TaskGraph const &) = delete;
+
+	template <typename F>
+	NodeId addTask(F &&func)
+	{
+		nodes_.emplace_back(std::forward<F>(func));
+		validated_ = false;
+		return nodes_.size() - 1;
+	}
+
+	/**
+	 * function: Task to be schduled
+	 * dependencies: Nodes which must be finished before this task is started
+	 */
+	template <typename F>
+	NodeId addTask(F &&func, std::initializer_list<NodeId> dependencies)
+	{
+		NodeId const id = addTask(std::forward<F>(func));
+		for (auto dependency: dependencies)
+			precede(dependency, id);
+		return id;
+	}
+
+	/**
+	 * Node "after" is started only when node "before" is finished
+	 */
+	void precede(NodeId before, NodeId after)
+	{
+		if (before >= nodes_.size() || after >= nodes_.size())
+			THROW_EXCEPTION(std::out_of_range, "Invalid node, before: " << before << ", after: " << after << ", nodes: " << nodes_.size());
+
+		nodes_[before].successors_.push_back(after);
+		++nodes_[after].dependencies_;
+		validated_ = false;
+	}
+
+	uint32_t size() const noexcept
+	{
+		return nodes_.size();
+	}
+
+	/**
+	 * Execute all the nodes on pool and wait for them to finish.
+	 * If a node throws, nodes which are not started yet are skipped
+	 * and the first exception is rethrown from here.
+	 */
+	void run(ThreadPool &pool)
+	{
+		validate();
+
+		if (nodes_.empty())
+			return;
+
+		for (uint32_t i = 0; i < nodes_.size(); ++i)
+			pending_[i].store(nodes_[i].dependencies_, std::memory_order_relaxed);
+
+		exception_ = nullptr;
+		failed_.store(false, std::memory_order_relaxed);
+		remaining_.store(nodes_.size(), std::memory_order_relaxed);
+		done_ = false;
+
+		pool_ = &pool;
+
+		for (auto root: roots_)
+			schedule(root);
+
+		std::unique_lock<std::mutex> lock{mt_};
+		cv_.wait(lock, [&](){
+			return done_;
+		});
+
+		if (exception_)
+			std::rethrow_exception(exception_);
+	}
+
+private:
+	struct Node
+	{
+		template <typename F>
+		explicit Node(F &&func): func_{std::forward<F>(func)}
+		{
+		}
+
+		std::function<void()> func_;
+		std::vector<NodeId> successors_;
+		uint32_t dependencies_{0};
+	};
+
+	void validate()
+	{
+		if (validated_)
+			return;
+
+		pending_.reset(new std::atomic<uint32_t>[nodes_.size()]);
+
+		roots_.clear();
+		for (NodeId i = 0; i < nodes_.size(); ++i)
+			if (nodes_[i].dependencies_ == 0)
+				roots_.push_back(i);
+
+		//Kahn's algorithm, every node must be reachable in topological order
+		std::vector<uint32_t> dependencies(nodes_.size());
+		for (NodeId i = 0; i < nodes_.size(); ++i)
+			dependencies[i] = nodes_[i].dependencies_;
+
+		std::vector<NodeId> ready{roots_};
+		uint32_t visited = 0;
+
+		while (! ready.empty())
+		{
+			NodeId const id = ready.back();
+			ready.pop_back();
+			++visited;
+
+			for (auto successor: nodes_[id].successors_)
+				if (--dependencies[successor] == 0)
+					ready.push_back(successor);
+		}
+
+		if (visited != nodes_.size())
+			THROW_EXCEPTION(std::logic_error, "Task graph has a cycle, reachable nodes: " << visited << ", total nodes: " << nodes_.size());
+
+		validated_ = true;
+	}
+
+	void schedule(NodeId id)
+	{
+		//Capture is kept within std::function small buffer, no allocation per node besides the threadpool queue
+		pool_->submitTask([this, id](){
+			execute(id);
+		});
+	}
+
+	void execute(NodeId id)
+	{
+		Node &node = nodes_[id];
+
+		if (! failed_.load(std::memory_order_acquire))
+		{
+			try
+			{
+				node.func_();
+			}
+			catch (...)
+			{
+				if (! failed_.exchange(true, std::memory_order_acq_rel))
+					exception_ = std::current_exception();
+			}
+		}
+
+		for (auto successor: node.successors_)
+			if (pending_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+				schedule(successor);
+
+		if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::unique_lock<std::mutex> lock{mt_};
+			done_ = true;
+			cv_.notify_all();
+		}
+	}
+
+	std::vector<Node> nodes_;
+	std::vector<NodeId> roots_;
+	std::unique_ptr<std::atomic<uint32_t>[]> pending_;
+	ThreadPool *pool_{nullptr};
+	std::atomic<uint32_t> remaining_{0};
+	std::atomic<bool> failed_{false};
+	std::exception_ptr exception_;
+	bool validated_{false};
+	bool done_{false};
+	std::mutex mt_;
+	std::condition_variable cv_;
+};
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <iomanip>
+
+namespace detail
+{
+
+/**
+ * Shared state of one parallel algorithm call. Caller waits
+ * till every element of the range is processed by some chunk.
+ */
+class ForkJoin
+{
+public:
+	explicit ForkJoin(size_t count): remaining_{count}
+	{
+	}
+
+	void finish(size_t count)
+	{
+		if (remaining_.fetch_sub(count, std::memory_order_acq_rel) == count)
+		{
+			std::unique_lock<std::mutex> lock{mt_};
+			done_ = true;
+			cv_.notify_all();
+		}
+	}
+
+	void fail(std::exception_ptr ex) noexcept
+	{
+		if (! failed_.exchange(true, std::memory_order_acq_rel))
+			exception_ = ex;
+	}
+
+	bool failed() const noexcept
+	{
+		return failed_.load(std::memory_order_acquire);
+	}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock{mt_};
+		cv_.wait(lock, [&](){
+			return done_;
+		});
+
+		if (exception_)
+			std::rethrow_exception(exception_);
+	}
+
+private:
+	std::atomic<size_t> remaining_;
+	std::atomic<bool> failed_{false};
+	std::exception_ptr exception_;
+	bool done_{false};
+	std::mutex mt_;
+	std::condition_variable cv_;
+};
+
+/**
+ * Around 8 chunks per thread, enough to balance uneven chunks
+ * without flooding the shared threadpool queue
+ */
+inline size_t autoGrain(ThreadPool const &pool, size_t count)
+{
+	size_t const chunks = std::max<size_t>(pool.threads(), 1) * 8;
+	return std::max<size_t>((count + chunks - 1) / chunks, 1);
+}
+
+/**
+ * Recursively halves [first, last) on grain boundaries, right halves are submitted
+ * to the pool and the current thread keeps the left half. Every leaf chunk is
+ * [k*grain, (k+1)*grain) so leaf index is first/grain.
+ */
+template<typename Body>
+void splitAndRun(ThreadPool &pool, ForkJoin &state, size_t first, size_t last, size_t grain, Body const &body)
+{
+	while (last - first > grain)
+	{
+		size_t const blocks = (last - first + grain - 1) / grain;
+		size_t const middle = first + (blocks / 2) * grain;
+
+		pool.submitTask([&pool, &state, middle, last, grain, &body](){
+			splitAndRun(pool, state, middle, last, grain, body);
+		});
+
+		last = middle;
+	}
+
+	if (! state.failed())
+	{
+		try
+		{
+			body(first, last);
+		}
+		catch (...)
+		{
+			state.fail(std::current_exception());
+		}
+	}
+
+	state.finish(last - first);
+}
+
+/**
+ * Runs body(first, last) over chunks of [0, count) on pool and the calling thread.
+ * Blocks till all chunks are done, so don't call it from a threadpool task.
+ */
+template<typename Body>
+void forkJoin(ThreadPool &pool, size_t count, size_t grain, Body const &body)
+{
+	if (count == 0)
+		return;
+
+	ForkJoin state{count};
+	splitAndRun(pool, state, 0, count, (grain == 0 ? autoGrain(pool, count) : grain), body);
+	state.wait();
+}
+
+}//end of namespace detail
+
+/**
+ * Parallel algorithms on ThreadPool.
+ * grain: Elements per chunk, 0 selects it from range size and threadpool size.
+ * All of them block the caller, which processes a chunk itself, and rethrow the
+ * first exception thrown by a chunk. Threadpool must be running.
+ */
+
+/**
+ * Calls func(*itr) for every iterator, or func(i) when first and last are integers
+ */
+template<typename It, typename F>
+void parallel_for(ThreadPool &pool, It first, It last, F const &func, size_t grain=0)
+{
+	detail::forkJoin(pool, last - first, grain, [first, &func](size_t begin, size_t end){
+		if constexpr (std::is_integral_v<It>)
+		{
+			for (It i = first + begin, last = first + end; i != last; ++i)
+				func(i);
+		}
+		else
+		{
+			for (It itr = first + begin, last = first + end; itr != last; ++itr)
+				func(*itr);
+		}
+	});
+}
+
+template<typename InputIt, typename OutputIt, typename UnaryOp>
+OutputIt parallel_transform(ThreadPool &pool, InputIt first, InputIt last, OutputIt d_first, UnaryOp const &op, size_t grain=0)
+{
+	size_t const count = last - first;
+
+	detail::forkJoin(pool, count, grain, [first, d_first, &op](size_t begin, size_t end){
+		std::transform(first + begin, first + end, d_first + begin, op);
+	});
+
+	return d_first + count;
+}
+
+/**
+ * op must be associative, partial results are combined in range order
+ * so it doesn't need to be commutative.
+ */
+template<typename It, typename T, typename BinaryOp=std::plus<>>
+T parallel_reduce(ThreadPool &pool, It first, It last, T init, BinaryOp const &op={}, size_t grain=0)
+{
+	size_t const count = last - first;
+
+	if (count == 0)
+		return init;
+
+	if (grain == 0)
+		grain = detail::autoGrain(pool, count);
+
+	std::vector<std::optional<T>> partials((count + grain - 1) / grain);
+
+	detail::forkJoin(pool, count, grain, [first, grain, &op, &partials](size_t begin, size_t end){
+		It itr = first + begin;
+		T partial = *itr;
+
+		for (It last = first + end; ++itr != last; )
+			partial = op(std::move(partial), *itr);
+
+		partials[begin / grain].emplace(std::move(partial));
+	});
+
+	for (auto &partial: partials)
+		init = op(std::move(init), std::move(*partial));
+
+	return init;
+}
+
+/**
+ * Chunks are sorted in parallel with std::sort and then merged in
+ * parallel rounds, each round doubling the sorted run length.
+ */
+template<typename It, typename Compare=std::less<>>
+void parallel_sort(ThreadPool &pool, It first, It last, Compare const &comp={}, size_t grain=0)
+{
+	size_t const count = last - first;
+
+	if (count < 2)
+		return;
+
+	//One run per thread, more runs only add merge rounds
+	if (grain == 0)
+		grain = std::max<size_t>((count + pool.threads() - 1) / std::max<uint32_t>(pool.threads(), 1), 1);
+
+	detail::forkJoin(pool, count, grain, [first, &comp](size_t begin, size_t end){
+		std::sort(first + begin, first + end, comp);
+	});
+
+	for (size_t width = grain; width < count; width *= 2)
+	{
+		size_t const pairs = (count + 2 * width - 1) / (2 * width);
+
+		detail::forkJoin(pool, pairs, 1, [first, count, width, &comp](size_t begin, size_t end){
+			for (size_t i = begin; i < end; ++i)
+			{
+				size_t const low = i * 2 * width;
+				size_t const middle = std::min(low + width, count);
+				size_t const high = std::min(low + 2 * width, count);
+
+				if (middle < high)
+					std::inplace_merge(first + low, first + middle, first + high, comp);
+			}
+		});
+	}
+}
+
+/**
+ * Compile with -DUSE_STD_EXECUTION (and -ltbb for libstdc++) to
+ * compare against std::execution::par as well.
+ */
+#ifdef USE_STD_EXECUTION
+#include <execution>
+#endif
+
+template<typename F>
+double measureMs(F &&func)
+{
+	auto const start = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(uint64_t const maxSize)
+{
+	ThreadPool pool;
+
+	std::cout << std::left << std::setw(12) << "Elements" << std::setw(12) << "Algorithm"
+		<< std::right << std::setw(14) << "Serial(ms)" << std::setw(16) << "ThreadPool(ms)"
+#ifdef USE_STD_EXECUTION
+		<< std::setw(14) << "std::par(ms)"
+#endif
+		<< std::endl;
+
+	auto const print = [](uint64_t size, char const *name, double serial, double pool, [[maybe_unused]] double stdPar){
+		std::cout << std::left << std::setw(12) << size << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(14) << serial << std::setw(16) << pool
+#ifdef USE_STD_EXECUTION
+			<< std::setw(14) << stdPar
+#endif
+			<< std::endl;
+	};
+
+	auto const work = [](double &x){
+		x = std::sqrt(x) * 1.5 + 1.0;
+	};
+
+	for (uint64_t size = 1000000; size <= maxSize; size *= 10)
+	{
+		std::vector<double> data(size);
+		std::iota(data.begin(), data.end(), 0.0);
+
+		double serial = measureMs([&]{ std::for_each(data.begin(), data.end(), work); });
+		double parallel = measureMs([&]{ parallel_for(pool, data.begin(), data.end(), work); });
+		double stdPar = 0;
+#ifdef USE_STD_EXECUTION
+		stdPar = measureMs([&]{ std::for_each(std::execution::par, data.begin(), data.end(), work); });
+#endif
+		print(size, "for", serial, parallel, stdPar);
+
+		double serialSum = 0, parallelSum = 0;
+		serial = measureMs([&]{ serialSum = std::accumulate(data.begin(), data.end(), 0.0); });
+		parallel = measureMs([&]{ parallelSum = parallel_reduce(pool, data.begin(), data.end(), 0.0); });
+		if (std::abs(serialSum - parallelSum) > 1e-6 * std::abs(serialSum))
+			THROW_EXCEPTION(std::logic_error, "parallel_reduce result mismatch, serial: " << serialSum << ", parallel: " << parallelSum);
+#ifdef USE_STD_EXECUTION
+		stdPar = measureMs([&]{ parallelSum = std::reduce(std::execution::par, data.begin(), data.end(), 0.0); });
+#endif
+		print(size, "reduce", serial, parallel, stdPar);
+
+		std::vector<double> output(size);
+		auto const op = [](double x){ return x * x + 0.5; };
+		serial = measureMs([&]{ std::transform(data.begin(), data.end(), output.begin(), op); });
+		parallel = measureMs([&]{ parallel_transform(pool, data.begin(), data.end(), output.begin(), op); });
+#ifdef USE_STD_EXECUTION
+		stdPar = measureMs([&]{ std::transform(std::execution::par, data.begin(), data.end(), output.begin(), op); });
+#endif
+		print(size, "transform", serial, parallel, stdPar);
+
+		std::mt19937_64 engine{size};
+		std::generate(data.begin(), data.end(), [&]{ return static_cast<double>(engine()); });
+		output = data;
+		serial = measureMs([&]{ std::sort(output.begin(), output.end()); });
+		output = data;
+		parallel = measureMs([&]{ parallel_sort(pool, output.begin(), output.end()); });
+		if (! std::is_sorted(output.begin(), output.end()))
+			THROW_EXCEPTION(std::logic_error, "parallel_sort result is not sorted, size: " << size);
+#ifdef USE_STD_EXECUTION
+		output = data;
+		stdPar = measureMs([&]{ std::sort(std::execution::par, output.begin(), output.end()); });
+#endif
+		print(size, "sort", serial, parallel, stdPar);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	//./a.out --benchmark [max elements, default 10M]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		benchmark(argc > 2 ? std::stoull(argv[2]) : 10000000);
+		return 0;
+	}
+
 	SCOPE_EXIT([]{
 		LOG("Out of scope main()... Terminating main()");
 	});
@@ -385,11 +1075,105 @@ int main()
 		return n*2;
 	}, 30);
 
+	StopSource timedOut;
+
+	pool.submitCancellableTask(timedOut.token(), [](StopToken const &token){
+		for (int32_t i = 0; i < 10 && ! token.stopRequested(); i += 1)
+		{
+			LOG("Task7 => " << i);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+
+	//Caller gave up before a worker picked this task, so it is never run
+	std::future<int> val2 = pool.submitCancellableTask(false, timedOut.token(), [](StopToken const &, int n){
+		LOG("Task8 => " << n);
+		return n;
+	}, 8);
+
+	timedOut.requestStop();
+
 	pool.shutdown();
 	pool.waitForPendingTasks();
 
 	LOG("Task5 return value: " << val.get());
 	LOG("Task6 return value: " << val1.get());
 
+	try
+	{
+		int const result = val2.get();
+		LOG("Task8 return value: " << result);
+	}
+	catch (TaskCancelled const &ex)
+	{
+		LOG("Task8 => " << ex.what());
+	}
+
+	ThreadPool graphPool{2};
+
+	// load -+-> parse -+-> report
+	//       |          |
+	//       +-> index -+
+	std::atomic<int32_t> counter{0};
+	TaskGraph graph;
+
+	auto load = graph.addTask([&](){
+		LOG("Graph => load");
+		counter.fetch_add(1, std::memory_order_relaxed);
+	});
+	auto parse = graph.addTask([&](){
+		LOG("Graph => parse");
+		counter.fetch_add(10, std::memory_order_relaxed);
+	}, {load});
+	auto index = graph.addTask([&](){
+		LOG("Graph => index");
+		counter.fetch_add(100, std::memory_order_relaxed);
+	}, {load});
+	graph.addTask([&](){
+		LOG("Graph => report, counter: " << counter.load(std::memory_order_relaxed));
+	}, {parse, index});
+
+	for (int32_t i = 0; i < 3; ++i)
+		graph.run(graphPool);
+
+	LOG("Graph counter after 3 runs: " << counter.load());
+
+	graphPool.shutdown();
+	graphPool.waitForPendingTasks();
+
+	ThreadPool algorithmPool{2};
+
+	std::vector<int32_t> numbers(1000);
+	std::iota(numbers.begin(), numbers.end(), 1);
+
+	parallel_for(algorithmPool, numbers.begin(), numbers.end(), [](int32_t &n){
+		n *= 2;
+	});
+	LOG("parallel_reduce => " << parallel_reduce(algorithmPool, numbers.begin(), numbers.end(), int64_t{0}));
+
+	std::vector<int32_t> squares(numbers.size());
+	parallel_transform(algorithmPool, numbers.begin(), numbers.end(), squares.begin(), [](int32_t n){
+		return n * n;
+	});
+	parallel_sort(algorithmPool, squares.begin(), squares.end(), std::greater<>{});
+	LOG("parallel_sort => " << squares.front() << " ... " << squares.back());
+
+	algorithmPool.shutdown();
+	algorithmPool.waitForPendingTasks();
+
+	ThreadPool overloaded{1};
+
+	overloaded.submitTask([](){
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	});
+
+	for (int32_t i = 0; i < 5; ++i)
+		overloaded.submitTask([i](){
+			LOG("Discarded task => " << i);
+		});
+
+	overloaded.shutdownNow();
+	overloaded.waitForPendingTasks();
+
 	return 0;
 }
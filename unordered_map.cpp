@@ -1,4 +1,18 @@
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <iterator>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 template<typename T1, typename T2>
 std::ostream & operator<<(std::ostream &out, std::pair<T1, T2> const &obj)
@@ -6,34 +20,201 @@ std::ostream & operator<<(std::ostream &out, std::pair<T1, T2> const &obj)
 	return out << obj.first << ":" << obj.second;
 }
 
-template<typename Type>
+/**
+ * Bytes held by the slab pools of the calling thread which are not handed
+ * out, free listed nodes plus the uncarved rest of the current slabs
+ */
+class SlabPoolBase
+{
+public:
+	static size_t idleBytes() noexcept
+	{
+		return _idleBytes;
+	}
+
+protected:
+	static inline thread_local size_t _idleBytes{0};
+};
+
+/**
+ * Fixed size node pool behind SlabAllocator. Nodes are carved out of 64KB slabs
+ * in address order and freed nodes are pushed on an intrusive free list, so
+ * steady insert/erase churn never reaches malloc and nodes allocated one after
+ * the other are next to each other in memory.
+ *
+ * One pool per thread and node size, no locking. A node freed by another thread
+ * goes to the free list of that thread. Slabs are never returned to the system,
+ * a node may still be in use by another thread when its pool thread exits, so
+ * the slabs and free list of an exited thread stay allocated for good.
+ * Meant for long lived threads only, programs whose threads come and go
+ * (e.g. a ThreadPool growing on demand) would leak without bound.
+ */
+template<size_t Size, size_t Align>
+class SlabPool : public SlabPoolBase
+{
+public:
+	static SlabPool & instance()
+	{
+		thread_local SlabPool pool;
+		return pool;
+	}
+
+	void * allocate()
+	{
+		_idleBytes -= SLOT_SIZE;
+
+		if (_free != nullptr)
+		{
+			FreeNode *node = _free;
+			_free = node->_next;
+			return node;
+		}
+
+		if (_cursor == _end)
+			grow();
+
+		void *node = _cursor;
+		_cursor += SLOT_SIZE;
+		return node;
+	}
+
+	void deallocate(void *ptr) noexcept
+	{
+		_idleBytes += SLOT_SIZE;
+
+		FreeNode *node = static_cast<FreeNode *>(ptr);
+		node->_next = _free;
+		_free = node;
+	}
+
+private:
+	struct FreeNode
+	{
+		FreeNode *_next;
+	};
+
+	static constexpr size_t SLOT_ALIGN = std::max(Align, alignof(FreeNode));
+	static constexpr size_t SLOT_SIZE = (std::max(Size, sizeof(FreeNode)) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+	static constexpr size_t SLAB_SIZE = std::max<size_t>(64 * 1024, SLOT_SIZE);
+
+	SlabPool() = default;
+
+	void grow()
+	{
+		char *slab = static_cast<char *>(::operator new(SLAB_SIZE, std::align_val_t(SLOT_ALIGN)));
+
+		_cursor = slab;
+		_end = slab + (SLAB_SIZE / SLOT_SIZE) * SLOT_SIZE;
+		_idleBytes += SLAB_SIZE;
+	}
+
+	FreeNode *_free{nullptr};
+	char *_cursor{nullptr};
+	char *_end{nullptr};
+};
+
+/**
+ * Stateless allocator, single objects come from the SlabPool of the calling
+ * thread, arrays from std::allocator. Opt in node allocator of LinkedList and
+ * UnorderedMap, see SlabPool for the thread lifetime requirement.
+ */
+template<typename T>
+struct SlabAllocator
+{
+	using value_type = T;
+
+	SlabAllocator() = default;
+
+	template<typename U>
+	SlabAllocator(SlabAllocator<U> const &) noexcept
+	{
+	}
+
+	T * allocate(size_t const n)
+	{
+		if (n != 1)
+			return std::allocator<T>().allocate(n);
+
+		return static_cast<T *>(SlabPool<sizeof(T), alignof(T)>::instance().allocate());
+	}
+
+	void deallocate(T *ptr, size_t const n) noexcept
+	{
+		if (n != 1)
+			std::allocator<T>().deallocate(ptr, n);
+		else
+			SlabPool<sizeof(T), alignof(T)>::instance().deallocate(ptr);
+	}
+
+	template<typename U>
+	bool operator==(SlabAllocator<U> const &) const noexcept
+	{
+		return true;
+	}
+
+	template<typename U>
+	bool operator!=(SlabAllocator<U> const &) const noexcept
+	{
+		return false;
+	}
+};
+
+/**
+ * Singly linked list used as UnorderedMap bucket. Every node caches the
+ * hash of its element, so the map can move nodes between buckets without
+ * calling the hasher again. Nodes are allocated with Allocator rebound to
+ * the node type.
+ */
+template<typename Type, typename Allocator=std::allocator<Type>>
 class LinkedList
 {
 	struct Node
 	{
 		Type _data{};
 		Node *_next{nullptr};
+		size_t _hash{0};
+
+		Node(Type &data, size_t hash): _data{std::move(data)}, _next{nullptr}, _hash{hash}
+		{
+		}
 
-		Node(Type &data): _data{std::move(data)}, _next{nullptr}
+		template<typename... Args>
+		Node(size_t hash, Args&&... args): _data(std::forward<Args>(args)...), _next{nullptr}, _hash{hash}
 		{
 		}
 	};
 
 	using NodePtr = Node *;
+	using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+	using NodeTraits = std::allocator_traits<NodeAllocator>;
 
 	NodePtr _head{nullptr}, _tail{nullptr};
 	uint32_t _count{0};
+	NodeAllocator _allocator{};
 
-	NodePtr _createNode (Type &data)
+	template<typename... Args>
+	NodePtr _createNode (Args&&... args)
 	{
-		NodePtr tmp = new Node(data);
+		NodePtr tmp = NodeTraits::allocate(_allocator, 1);
+
+		try
+		{
+			NodeTraits::construct(_allocator, tmp, std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			NodeTraits::deallocate(_allocator, tmp, 1);
+			throw;
+		}
+
 		++_count;
 		return tmp;
 	}
 
 	void _releaseNode (NodePtr node)
 	{
-		delete node;
+		NodeTraits::destroy(_allocator, node);
+		NodeTraits::deallocate(_allocator, node, 1);
 		--_count;
 	}
 
@@ -62,7 +243,20 @@ class LinkedList
 		_count = 0;
 	}
 
+	void _linkFront(NodePtr node) noexcept
+	{
+		node->_next = _head;
+		_head = node;
+
+		if (_tail == nullptr)
+			_tail = node;
+
+		++_count;
+	}
+
 public:
+	static constexpr size_t NODE_SIZE = sizeof(Node);
+
 	class Iterator
 	{
 		NodePtr _node{nullptr};
@@ -154,7 +348,7 @@ public:
 	LinkedList(LinkedList &list)
 	{
 		for (NodePtr tmp = list._head; tmp != nullptr; tmp = tmp->_next)
-			push_back(tmp->_data);
+			push_back(tmp->_data, tmp->_hash);
 	}
 
 	LinkedList(LinkedList &&list)
@@ -169,7 +363,7 @@ public:
 		{
 			LinkedList newList;
 			for (NodePtr tmp = list._head; tmp != nullptr; tmp = tmp->_next)
-				newList.push_back(tmp->_data);
+				newList.push_back(tmp->_data, tmp->_hash);
 
 			swap(newList);
 			newList.clear();
@@ -198,9 +392,9 @@ public:
 		return *this;
 	}
 
-	void push_back(Type data)
+	void push_back(Type data, size_t hash=0)
 	{
-		NodePtr newNode = _createNode (data);
+		NodePtr newNode = _createNode (data, hash);
 		if (empty())
 			_head = _tail = newNode;
 		else
@@ -210,9 +404,9 @@ public:
 		}
 	}
 
-	void push_front(Type data)
+	void push_front(Type data, size_t hash=0)
 	{
-		NodePtr newNode = _createNode (data);
+		NodePtr newNode = _createNode (data, hash);
 		if (empty())
 			_head = _tail = newNode;
 		else
@@ -222,6 +416,45 @@ public:
 		}
 	}
 
+	template<typename... Args>
+	void emplace_front(size_t hash, Args&&... args)
+	{
+		NodePtr newNode = _createNode (hash, std::forward<Args>(args)...);
+
+		newNode->_next = _head;
+		_head = newNode;
+
+		if (_tail == nullptr)
+			_tail = newNode;
+	}
+
+	/**
+	 * First element with cached hash equal to hash and pred(element) true
+	 */
+	template<typename Pred>
+	Iterator findHashed(size_t hash, Pred pred) const
+	{
+		for (NodePtr tmp = _head; tmp != nullptr; tmp = tmp->_next)
+			if (tmp->_hash == hash && pred(tmp->_data))
+				return Iterator(tmp);
+
+		return Iterator();
+	}
+
+	template<typename Pred>
+	bool removeHashed(size_t hash, Pred pred)
+	{
+		for (NodePtr parent{nullptr}, current = _head; current != nullptr; parent = current, current = current->_next)
+		{
+			if (current->_hash == hash && pred(current->_data))
+			{
+				_removeNode (current, parent);
+				return true;
+			}
+		}
+		return false;
+	}
+
 	template<typename Comp=std::equal_to<Type>>
 	Iterator find(Type const &data, Comp cmp={}) const
 	{
@@ -246,7 +479,7 @@ public:
 	template<typename Comp=std::equal_to<Type>>
 	bool remove(Type const &data, Comp cmp={})
 	{
-		NodePtr parent, current;
+		NodePtr parent{nullptr}, current;
 		for (current = _head; current != nullptr; parent = current, current = current->_next)
 		{
 			if (cmp(current->_data, data))
@@ -295,6 +528,23 @@ public:
 		return Iterator();
 	}
 
+	/**
+	 * Moves every node to the front of list target(cached hash of the node).
+	 * Nodes are relinked, elements are neither copied nor moved.
+	 */
+	template<typename F>
+	void relink(F &&target) noexcept
+	{
+		while (_head != nullptr)
+		{
+			NodePtr node = _head;
+			_head = _head->_next;
+			target(node->_hash)._linkFront(node);
+		}
+
+		_reset();
+	}
+
 	void swap(LinkedList &list) noexcept
 	{
 		std::swap(_head, list._head);
@@ -313,8 +563,8 @@ public:
 	}
 };
 
-template<typename Type>
-std::ostream & operator<<(std::ostream &out, LinkedList<Type> const &list)
+template<typename Type, typename Allocator>
+std::ostream & operator<<(std::ostream &out, LinkedList<Type, Allocator> const &list)
 {
 	if (list.empty())
 		return out;
@@ -329,34 +579,148 @@ std::ostream & operator<<(std::ostream &out, LinkedList<Type> const &list)
 	return out;
 }
 
-template<typename KeyType, typename MappedType, typename Hasher=std::hash<KeyType>, typename EqualTo=std::equal_to<KeyType>>
+template<typename T, typename = void>
+struct IsTransparent: std::false_type
+{
+};
+
+template<typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>>: std::true_type
+{
+};
+
+/**
+ * Transparent string hasher, hashes std::string, std::string_view
+ * and const char * alike so lookups don't build a std::string
+ */
+struct StringHash
+{
+	using is_transparent = void;
+
+	size_t operator()(std::string_view const str) const noexcept
+	{
+		return std::hash<std::string_view>{}(str);
+	}
+};
+
+/**
+ * Bucket policies of UnorderedMap, decide the bucket count for a requested
+ * size and map a hash to a bucket index.
+ *
+ * ModuloBucketPolicy: hash % bucketCount, any bucket count.
+ * PowerOfTwoBucketPolicy: bucket count is rounded up to a power of two, at most
+ * 2^31, and the mixed hash is masked, no integer division on lookup. Mixer must
+ * spread the hash into the low bits since std::hash of integers is identity.
+ */
+struct ModuloBucketPolicy
+{
+	static uint32_t bucketCount(uint32_t const size) noexcept
+	{
+		return size == 0 ? 1 : size;
+	}
+
+	static uint32_t index(size_t const hash, uint32_t const bucketCount) noexcept
+	{
+		return hash % bucketCount;
+	}
+};
+
+/**
+ * Fibonacci hashing, multiply by 2^64/golden ratio and fold the well mixed high half into the low half
+ */
+struct FibonacciMixer
+{
+	uint64_t operator()(uint64_t hash) const noexcept
+	{
+		hash *= 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 32);
+	}
+};
+
+/**
+ * wyhash style mixer, xor of both halves of a 64x64 => 128 bit multiply
+ */
+struct WyMixer
+{
+	uint64_t operator()(uint64_t const hash) const noexcept
+	{
+		__uint128_t const product = static_cast<__uint128_t>(hash ^ 0xa0761d6478bd642full) * 0xe7037ed1a0b428dbull;
+		return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+	}
+};
+
+template<typename Mixer=FibonacciMixer>
+struct PowerOfTwoBucketPolicy
+{
+	static constexpr uint32_t MAX_BUCKET_COUNT = uint32_t{1} << 31;
+
+	static uint32_t bucketCount(uint32_t const size) noexcept
+	{
+		if (size > MAX_BUCKET_COUNT)
+			return MAX_BUCKET_COUNT;
+
+		uint32_t count = 1;
+		while (count < size)
+			count <<= 1;
+		return count;
+	}
+
+	static uint32_t index(size_t const hash, uint32_t const bucketCount) noexcept
+	{
+		return Mixer{}(hash) & (bucketCount - 1);
+	}
+};
+
+/**
+ * Allocator: Allocator of the bucket nodes, std::allocator by default,
+ * SlabAllocator for insert/erase heavy maps used by long lived threads
+ */
+template<typename KeyType, typename MappedType, typename Hasher=std::hash<KeyType>, typename EqualTo=std::equal_to<KeyType>, typename BucketPolicy=ModuloBucketPolicy, typename Allocator=std::allocator<std::pair<const KeyType, MappedType>>>
 class UnorderedMap
 {
 public:
 	using ValueType = std::pair<const KeyType, MappedType>;
+	using Bucket = LinkedList<ValueType, Allocator>;
 
 	class UMIterator
 	{
 	public:
 		UMIterator() = default;
 
-		UMIterator & set(LinkedList<ValueType> *bucket, uint32_t bucketSize) noexcept
+		UMIterator & set(Bucket *bucket, uint64_t const *occupied, uint32_t bucketSize) noexcept
 		{
 			_bucket = bucket;
+			_occupied = occupied;
 			_bucketSize = bucketSize;
 
 			return *this;
 		}
 
-		UMIterator & set(typename LinkedList<ValueType>::Iterator itr) noexcept
+		/**
+		 * Buckets of a pending incremental rehash not migrated yet, walked
+		 * after the new buckets, only set by const begin()
+		 */
+		UMIterator & setOld(Bucket *oldBucket, uint32_t oldBucketSize) noexcept
+		{
+			_oldBucket = oldBucket;
+			_oldBucketSize = oldBucketSize;
+
+			return *this;
+		}
+
+		UMIterator & set(typename Bucket::Iterator itr) noexcept
 		{
 			_itr = itr;
 			return *this;
 		}
 
+		/**
+		 * Needs the bitmap, set(bucket, occupied, bucketSize) comes first
+		 */
 		UMIterator & set(uint32_t const index) noexcept
 		{
 			_currentIndex = index;
+			_pending = (index < _bucketSize ? _occupied[index >> 6] & (~1ull << (index & 63)) : 0);
 			return *this;
 		}
 
@@ -406,33 +770,73 @@ public:
 		std::ostream & printDebug(std::ostream &out)
 		{
 			out << "Bucketsize: " << _bucketSize << ", Currentindex: " << _currentIndex << " => ";
-			out << _bucket[_currentIndex] << std::endl;
+			if (_currentIndex < _bucketSize)
+				out << _bucket[_currentIndex];
+			out << std::endl;
 			return out;
 		}
 
 	private:
 		void increment()
 		{
-			if ((_itr == _bucket[_currentIndex].end()) || (++_itr == _bucket[_currentIndex].end()))
+			if ((_itr == typename Bucket::Iterator()) || (++_itr == typename Bucket::Iterator()))
 			{
-				for (uint32_t index = _currentIndex + 1; index < _bucketSize; ++index)
+				if (_currentIndex < _bucketSize)
+					nextNewBucket();
+				else
+					++_currentIndex;
+
+				//Old buckets are indexed after the new ones and have no bitmap
+				while (_currentIndex >= _bucketSize && _currentIndex - _bucketSize < _oldBucketSize && _oldBucket[_currentIndex - _bucketSize].empty())
+					++_currentIndex;
+
+				//Past the last element, same as UnorderedMap::end()
+				if (_currentIndex >= _bucketSize && _currentIndex - _bucketSize >= _oldBucketSize)
 				{
-					if (! _bucket[index].empty())
-					{
-						_itr = _bucket[index].begin();
-						_currentIndex = index;
-						break;
-					}
+					_currentIndex = END_INDEX;
+					_itr = typename Bucket::Iterator();
+					return;
 				}
+
+				_itr = (_currentIndex < _bucketSize ? _bucket[_currentIndex] : _oldBucket[_currentIndex - _bucketSize]).begin();
 			}
 		}
 
-		LinkedList<ValueType> *_bucket{nullptr};
+		/**
+		 * Occupied buckets left in the bitmap word of _currentIndex, then the
+		 * following words, _bucketSize when there are none. A bucket emptied by
+		 * an erase since _pending was read is skipped.
+		 */
+		void nextNewBucket() noexcept
+		{
+			do
+			{
+				if (_pending != 0)
+				{
+					_currentIndex = (_currentIndex & ~63u) | __builtin_ctzll(_pending);
+					_pending &= _pending - 1;
+					continue;
+				}
+
+				_currentIndex = nextOccupied(_occupied, _bucketSize, (_currentIndex | 63) + 1);
+
+				if (_currentIndex == _bucketSize)
+					return;
+
+				_pending = _occupied[_currentIndex >> 6] & (~1ull << (_currentIndex & 63));
+			} while (_bucket[_currentIndex].empty());
+		}
+
+		Bucket *_bucket{nullptr};
+		uint64_t const *_occupied{nullptr};
+		uint64_t _pending{0};
 		uint32_t _bucketSize{0};
 		uint32_t _currentIndex{0};
-		typename LinkedList<ValueType>::Iterator _itr;
+		Bucket *_oldBucket{nullptr};
+		uint32_t _oldBucketSize{0};
+		typename Bucket::Iterator _itr;
 
-		template<typename K, typename M, typename H, typename E>
+		template<typename K, typename M, typename H, typename E, typename P, typename A>
 		friend class UnorderedMap;
 	};
 
@@ -446,33 +850,70 @@ public:
 
 	~UnorderedMap()
 	{
+		delete [] _oldBucket;
 		delete [] _bucket;
+		delete [] _occupied;
+	}
+
+	/**
+	 * Buckets for size elements, no rehash until size is exceeded
+	 */
+	explicit UnorderedMap(uint32_t const size)
+	{
+		reserve(size);
 	}
 
 	UnorderedMap(std::initializer_list<std::pair<KeyType, MappedType>> const &list)
 	{
-		reserve(list.size());
+		build(list.begin(), list.end());
+	}
 
-		for (auto const &ele: list)
-			insert(ele.first, ele.second);
+	template<typename ForwardIt, typename=std::enable_if_t<! std::is_integral_v<ForwardIt>>>
+	UnorderedMap(ForwardIt first, ForwardIt last)
+	{
+		build(first, last);
 	}
 
-	UMIterator begin() const
+	/**
+	 * Finishes a pending incremental rehash, so lookups while iterating
+	 * don't move elements under the iterator
+	 */
+	UMIterator begin()
 	{
-		uint32_t index = firstNonEmptyBucketIndex();
+		completeRehash();
+
+		return static_cast<UnorderedMap const &>(*this).begin();
+	}
 
+	/**
+	 * Read only, a pending incremental rehash is not finished, the buckets
+	 * not migrated yet are walked after the new ones. Threads can iterate
+	 * the same const map concurrently.
+	 */
+	UMIterator begin() const
+	{
 		UMIterator itr;
-		itr.set(_bucket, _bucketSize).set(index).set(_bucket[index].begin());
+		itr.set(_bucket, _occupied, _bucketSize).setOld(_oldBucket + _migrateIndex, _oldBucketSize - _migrateIndex);
+
+		uint32_t const index = nextOccupied(_occupied, _bucketSize, 0);
+
+		if (index < _bucketSize)
+			return itr.set(index).set(_bucket[index].begin());
+
+		//No element in the new buckets, start past them
+		itr.set(_bucketSize - 1);
+		itr.increment();
 
 		return itr;
 	}
 
+	/**
+	 * End doesn't depend on the content nor on a pending rehash
+	 */
 	UMIterator end() const
 	{
-		uint32_t index = lastNonEmptyBucketIndex();
-
 		UMIterator itr;
-		itr.set(_bucket, _bucketSize).set(index).set(_bucket[index].end());
+		itr.set(_bucket, _occupied, _bucketSize).set(END_INDEX);
 
 		return itr;
 	}
@@ -487,11 +928,93 @@ public:
 		return _count == 0;
 	}
 
+	uint32_t bucketCount() const noexcept
+	{
+		return _bucketSize;
+	}
+
+	/**
+	 * Bytes of the map, its bucket arrays and nodes, memory owned by keys and
+	 * values themselves (e.g. long std::string) is not included
+	 */
+	size_t memory_usage() const noexcept
+	{
+		return sizeof(*this) + size_t{_bucketSize} * sizeof(Bucket) + (_bucketSize + 63) / 64 * sizeof(uint64_t)
+			+ size_t{_oldBucketSize} * sizeof(Bucket) + size_t{_count} * Bucket::NODE_SIZE;
+	}
+
+	/**
+	 * Makes room for size elements without exceeding the max load factor, so
+	 * inserting up to size elements never rehashes. Never shrinks the table,
+	 * elements already present are relinked into the new buckets.
+	 */
 	void reserve(uint32_t const size)
 	{
-		_bucketSize = size;
-		_bucket = new LinkedList<ValueType>[_bucketSize];
+		uint32_t const bucketSize = BucketPolicy::bucketCount(std::max<uint32_t>(1, (size + _maxLoadFactor - 1) / _maxLoadFactor));
+
+		if (_bucket != nullptr && bucketSize <= _bucketSize)
+			return;
+
+		resize(bucketSize);
+		completeRehash();
+	}
+
+	/**
+	 * Bulk insert of [first, last), elements are pairs of key and mapped value.
+	 * Table is sized once for all of them and the keys are hashed and reduced
+	 * to bucket indices in tight loops ahead of the inserts, so the insert loop
+	 * can prefetch buckets it reaches later instead of waiting on each one.
+	 * Same semantics as insert, the last duplicate wins.
+	 */
+	template<typename ForwardIt>
+	void build(ForwardIt first, ForwardIt last)
+	{
+		uint32_t const length = std::distance(first, last);
+
+		reserve(_count + length);
+		completeRehash();
+
+		std::vector<size_t> hashes(length);
+		std::vector<uint32_t> indices(length);
+
+		ForwardIt itr = first;
+		for (uint32_t i = 0; i < length; ++i, ++itr)
+			hashes[i] = _hash(itr->first);
+
+		for (uint32_t i = 0; i < length; ++i)
+			indices[i] = BucketPolicy::index(hashes[i], _bucketSize);
+
+		constexpr uint32_t PREFETCH_DISTANCE = 16;
+
+		for (uint32_t i = 0; i < length; ++i, ++first)
+		{
+			if (i + PREFETCH_DISTANCE < length)
+				__builtin_prefetch(&_bucket[indices[i + PREFETCH_DISTANCE]]);
+
+			Bucket &bucket = _bucket[indices[i]];
+			auto const &key = first->first;
+
+			auto bucketItr = bucket.findHashed(hashes[i], [&](ValueType const &ele){
+				return _equal(ele.first, key);
+			});
+
+			if (bucketItr != bucket.end())
+				bucketItr->second = first->second;
+			else
+			{
+				bucket.emplace_front(hashes[i], key, first->second);
+				markOccupied(indices[i]);
+				++_count;
+			}
+		}
+	}
+
+	template<typename Range>
+	void build(Range const &range)
+	{
+		build(std::begin(range), std::end(range));
 	}
+
 	void setBucketSizeMultiplier(uint8_t factor) noexcept
 	{
 		if (factor > 1)
@@ -504,96 +1027,162 @@ public:
 			_maxLoadFactor = factor;
 	}
 
+	/**
+	 * bucketsPerOperation: 0 => rehash moves all the elements at once (default).
+	 * Otherwise rehash only allocates the new bucket array and every insert/erase
+	 * moves at most bucketsPerOperation non empty buckets from the old array,
+	 * so no single insert pays for the whole rehash. Lookups move the bucket
+	 * of the key first, so found elements are always in the new array.
+	 * begin() of a non const map finishes a pending rehash, a const map
+	 * is iterated without changing it.
+	 */
+	void setIncrementalRehash(uint32_t bucketsPerOperation)
+	{
+		_rehashStep = bucketsPerOperation;
+
+		if (_rehashStep == 0)
+			completeRehash();
+	}
+
 	void rehash(uint32_t newBucketSize)
 	{
 		if ((_count/_bucketSize) < _maxLoadFactor)
 			return;
 
-		std::cout << "Rehasing needed from " << _bucketSize << " to " << newBucketSize << std::endl;
-
-		LinkedList<ValueType> *newBucket = new LinkedList<ValueType>[newBucketSize];
+		//Policy may be at its largest bucket count already
+		uint32_t const bucketSize = BucketPolicy::bucketCount(newBucketSize);
+		if (bucketSize <= _bucketSize)
+			return;
 
-		for (uint32_t i = 0; i < _bucketSize; ++i)
-		{
-			for (auto start = _bucket[i].begin(), end = _bucket[i].end(); start != end; ++start)
-			{
-				typename LinkedList<ValueType>::Iterator itr;
-				insertOrUpdate(newBucket, newBucketSize, start->first, start->second, itr);
-			}
-		}
+		resize(bucketSize);
 
-		std::swap(_bucket, newBucket);
-		std::swap(_bucketSize, newBucketSize);
+		if (_rehashStep == 0)
+			completeRehash();
+	}
 
-		delete []newBucket;
+	bool rehashInProgress() const noexcept
+	{
+		return _oldBucket != nullptr;
 	}
 
-	std::pair<bool, UMIterator> insert(KeyType const &key, MappedType const &mappedValue)
+	/**
+	 * Inserts or updates the mapped value of key. Rvalue key and
+	 * mapped value are moved into the map.
+	 */
+	template<typename K, typename M>
+	std::pair<bool, UMIterator> insert(K &&key, M &&mappedValue)
 	{
-		rehash(_bucketSize * _bucketSizeMultiplierFactor);
+		typename Bucket::Iterator tempItr;
+
+		std::pair<bool, uint32_t> status = tryEmplace(std::forward<K>(key), tempItr, std::forward<M>(mappedValue));
 
-		typename LinkedList<ValueType>::Iterator tempItr;
+		if (! status.first)
+			tempItr->second = std::forward<M>(mappedValue);
 
-		std::pair<bool, uint32_t> status = insertOrUpdate(_bucket, _bucketSize, key, mappedValue, tempItr);
+		return {status.first, iteratorAt(status.second, tempItr)};
+	}
 
-		if (status.first)
-			++_count;
+	/**
+	 * Constructs mapped value from args in place only if key is not present,
+	 * args are left untouched otherwise
+	 */
+	template<typename K, typename... Args>
+	std::pair<bool, UMIterator> try_emplace(K &&key, Args&&... args)
+	{
+		typename Bucket::Iterator tempItr;
 
-		UMIterator itr;
-		itr.set(_bucket, _bucketSize).set(status.second).set(tempItr);
+		std::pair<bool, uint32_t> status = tryEmplace(std::forward<K>(key), tempItr, std::forward<Args>(args)...);
 
-		return {status.first, itr};
+		return {status.first, iteratorAt(status.second, tempItr)};
 	}
 
-	MappedType & operator[](KeyType const &key)
+	/**
+	 * Same as try_emplace, existing mapped value is not updated
+	 */
+	template<typename K, typename M>
+	std::pair<bool, UMIterator> emplace(K &&key, M &&mappedValue)
 	{
-		rehash(_bucketSize * _bucketSizeMultiplierFactor);
-
-		typename LinkedList<ValueType>::Iterator tempItr;
+		return try_emplace(std::forward<K>(key), std::forward<M>(mappedValue));
+	}
 
-		std::pair<bool, uint32_t> status = insertOrUpdate(_bucket, _bucketSize, key, MappedType{}, tempItr);
+	template<typename K>
+	MappedType & operator[](K &&key)
+	{
+		typename Bucket::Iterator tempItr;
 
-		if (status.first)
-			++_count;
+		tryEmplace(std::forward<K>(key), tempItr);
 
 		return tempItr->second;
 	}
 
-	UMIterator find(KeyType const &key)
+	/**
+	 * Any key type K is accepted when both Hasher and EqualTo are transparent
+	 * (define is_transparent, e.g. StringHash and std::equal_to<>), so a
+	 * std::string map can be searched with std::string_view or const char *
+	 * without building a std::string. Otherwise key is converted to KeyType.
+	 */
+	template<typename K>
+	UMIterator find(K const &key)
 	{
-		typename LinkedList<ValueType>::Iterator tempItr;
-		std::pair<bool, uint32_t> status = find(key, tempItr);
-
-		if (! status.first)
-			return end();
+		if constexpr (! isLookupKey<K>)
+			return find(KeyType(key));
+		else
+		{
+			typename Bucket::Iterator tempItr;
+			std::pair<bool, uint32_t> status = find(key, tempItr);
 
-		UMIterator itr;
-		itr.set(_bucket, _bucketSize).set(status.second).set(tempItr);
+			if (! status.first)
+				return end();
 
-		return itr;
+			return iteratorAt(status.second, tempItr);
+		}
 	}
 
-	bool erase(KeyType const &key)
+	template<typename K>
+	bool erase(K const &key)
 	{
-		uint32_t index = getBucketIndex(key);
-		return _bucket[index].remove(ValueType(key, MappedType()), [](ValueType const &lhs, ValueType const &rhs){
-			return lhs.first == rhs.first;
-		});
+		if constexpr (! isLookupKey<K>)
+			return erase(KeyType(key));
+		else
+		{
+			rehashStep();
+			migrateBucketOf(key);
+
+			size_t const hash = _hash(key);
+			uint32_t const index = BucketPolicy::index(hash, _bucketSize);
+			bool const status = _bucket[index].removeHashed(hash, [&](ValueType const &ele){
+				return _equal(ele.first, key);
+			});
+
+			if (status)
+			{
+				--_count;
+
+				if (_bucket[index].empty())
+					markEmpty(index);
+			}
+
+			return status;
+		}
 	}
 
 	UMIterator erase(UMIterator const &keyItr)
 	{
-		typename LinkedList<ValueType>::Iterator parentItr;
+		typename Bucket::Iterator parentItr;
 
 		auto start = _bucket[keyItr._currentIndex].begin(), end = _bucket[keyItr._currentIndex].end();
 		for (; start != end; parentItr = start, ++start)
 			if (start == keyItr._itr)
 				break;
 
-		typename LinkedList<ValueType>::Iterator nextItr = _bucket[keyItr._currentIndex].remove(keyItr._itr, parentItr);
+		typename Bucket::Iterator nextItr = _bucket[keyItr._currentIndex].remove(keyItr._itr, parentItr);
+		--_count;
+
+		if (_bucket[keyItr._currentIndex].empty())
+			markEmpty(keyItr._currentIndex);
 
 		UMIterator itr;
-		itr.set(_bucket, _bucketSize).set(keyItr._currentIndex).set(nextItr);
+		itr.set(_bucket, _occupied, _bucketSize).set(keyItr._currentIndex).set(nextItr);
 
 		if (nextItr == _bucket[keyItr._currentIndex].end())
 			++itr;
@@ -606,105 +1195,2817 @@ public:
 		out << "Bucketsize: " << _bucketSize << ", Count: " << _count << ", Maxloadfactor: " << _maxLoadFactor << " => \n";
 		for (uint32_t i = 0; i < _bucketSize; ++i)
 			out << _bucket[i] << std::endl;
+
+		if (rehashInProgress())
+		{
+			out << "Old bucketsize: " << _oldBucketSize << ", Migrated: " << _migrateIndex << " => \n";
+			for (uint32_t i = _migrateIndex; i < _oldBucketSize; ++i)
+				out << _oldBucket[i] << std::endl;
+		}
+
+		return out;
+	}
+
+private:
+	template<typename K>
+	static constexpr bool isLookupKey = std::is_same_v<K, KeyType> || (IsTransparent<Hasher>::value && IsTransparent<EqualTo>::value);
+
+	//Bucket index of end(), past the new and the old buckets
+	static constexpr uint32_t END_INDEX = ~uint32_t{0};
+
+	UMIterator iteratorAt(uint32_t const index, typename Bucket::Iterator const &itr) const
+	{
+		UMIterator umItr;
+		umItr.set(_bucket, _occupied, _bucketSize).set(index).set(itr);
+
+		return umItr;
+	}
+
+	/**
+	 * Nodes cache the hash, keys are compared only when hashes are equal
+	 */
+	template<typename K>
+	std::pair<bool, uint32_t> find(K const &key, typename Bucket::Iterator &itr)
+	{
+		migrateBucketOf(key);
+
+		size_t const hash = _hash(key);
+		uint32_t const index = BucketPolicy::index(hash, _bucketSize);
+
+		itr = _bucket[index].findHashed(hash, [&](ValueType const &ele){
+			return _equal(ele.first, key);
+		});
+
+		return {itr != _bucket[index].end(), index};
+	}
+
+	/**
+	 * Looks up key and constructs ValueType(key, MappedType(args...)) in front of
+	 * its bucket if it's not present. Key is converted to KeyType only on insert.
+	 * return: {inserted, bucket index}, itr points to the element of key
+	 */
+	template<typename K, typename... Args>
+	std::pair<bool, uint32_t> tryEmplace(K &&key, typename Bucket::Iterator &itr, Args&&... args)
+	{
+		if constexpr (! isLookupKey<std::decay_t<K>>)
+			return tryEmplace(KeyType(std::forward<K>(key)), itr, std::forward<Args>(args)...);
+		else
+		{
+			rehash(_bucketSize * _bucketSizeMultiplierFactor);
+			rehashStep();
+			migrateBucketOf(key);
+
+			size_t const hash = _hash(key);
+			uint32_t const index = BucketPolicy::index(hash, _bucketSize);
+
+			itr = _bucket[index].findHashed(hash, [&](ValueType const &ele){
+				return _equal(ele.first, key);
+			});
+
+			if (itr != _bucket[index].end())
+				return {false, index};
+
+			_bucket[index].emplace_front(hash, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+			itr = _bucket[index].begin();
+			markOccupied(index);
+			++_count;
+
+			return {true, index};
+		}
+	}
+
+	/**
+	 * Allocates newBucketSize buckets, the current ones become the old
+	 * buckets of a rehash which is completed by the caller or step by step
+	 */
+	void resize(uint32_t const newBucketSize)
+	{
+		completeRehash();
+
+		_oldBucket = _bucket;
+		_oldBucketSize = (_bucket == nullptr ? 0 : _bucketSize);
+		_migrateIndex = 0;
+
+		_bucket = new Bucket[newBucketSize];
+		_bucketSize = newBucketSize;
+
+		//Only the new buckets are iterated, the old ones need no bitmap
+		delete [] _occupied;
+		_occupied = new uint64_t[(newBucketSize + 63) / 64]();
+	}
+
+	/**
+	 * Splices every node of old bucket index into the new bucket array,
+	 * bucket is selected from the hash cached in the node
+	 */
+	void migrateBucket(uint32_t const index)
+	{
+		_oldBucket[index].relink([this](size_t const hash) -> Bucket & {
+			uint32_t const newIndex = BucketPolicy::index(hash, _bucketSize);
+			markOccupied(newIndex);
+			return _bucket[newIndex];
+		});
+	}
+
+	template<typename K>
+	void migrateBucketOf(K const &key)
+	{
+		if (! rehashInProgress())
+			return;
+
+		uint32_t const index = getBucketIndex(key, _oldBucketSize);
+
+		if (! _oldBucket[index].empty())
+			migrateBucket(index);
+	}
+
+	/**
+	 * Moves up to _rehashStep non empty buckets, empty buckets are cheap
+	 * but not free so at most 10 times as many are skipped per call
+	 */
+	void rehashStep()
+	{
+		if (! rehashInProgress())
+			return;
+
+		for (uint32_t moved = 0, visited = 0; _migrateIndex < _oldBucketSize && moved < _rehashStep && visited < _rehashStep * 10; ++_migrateIndex, ++visited)
+		{
+			if (! _oldBucket[_migrateIndex].empty())
+			{
+				migrateBucket(_migrateIndex);
+				++moved;
+			}
+		}
+
+		if (_migrateIndex == _oldBucketSize)
+			completeRehash();
+	}
+
+	void completeRehash()
+	{
+		if (! rehashInProgress())
+			return;
+
+		for (; _migrateIndex < _oldBucketSize; ++_migrateIndex)
+			if (! _oldBucket[_migrateIndex].empty())
+				migrateBucket(_migrateIndex);
+
+		delete [] _oldBucket;
+		_oldBucket = nullptr;
+		_oldBucketSize = 0;
+		_migrateIndex = 0;
+	}
+
+	/**
+	 * Occupancy bitmap, bit i is set while bucket i is not empty. Iteration
+	 * skips 64 empty buckets per word with a trailing zero count, so a walk
+	 * over the map costs O(count + bucketSize / 64) instead of O(bucketSize).
+	 */
+	static uint32_t nextOccupied(uint64_t const *occupied, uint32_t const bucketSize, uint32_t const from) noexcept
+	{
+		if (from >= bucketSize)
+			return bucketSize;
+
+		uint32_t word = from >> 6;
+		uint64_t bits = occupied[word] & (~0ull << (from & 63));
+
+		while (bits == 0)
+		{
+			if (++word * 64 >= bucketSize)
+				return bucketSize;
+
+			bits = occupied[word];
+		}
+
+		return word * 64 + __builtin_ctzll(bits);
+	}
+
+	void markOccupied(uint32_t const index) noexcept
+	{
+		_occupied[index >> 6] |= 1ull << (index & 63);
+	}
+
+	void markEmpty(uint32_t const index) noexcept
+	{
+		_occupied[index >> 6] &= ~(1ull << (index & 63));
+	}
+
+	template<typename K>
+	uint32_t getBucketIndex(K const &key, uint32_t bucketSize=0) const noexcept
+	{
+		uint32_t const size = (bucketSize == 0 ? _bucketSize : bucketSize);
+		return BucketPolicy::index(_hash(key), size);
+	}
+
+	Bucket *_bucket{nullptr};
+	uint64_t *_occupied{nullptr};
+	uint32_t _bucketSize{0};
+	Bucket *_oldBucket{nullptr};
+	uint32_t _oldBucketSize{0};
+	uint32_t _migrateIndex{0};
+	uint32_t _rehashStep{0};
+	Hasher _hash{};
+	EqualTo _equal{};
+	uint32_t _maxLoadFactor{1};
+	uint32_t _count{0};
+	uint8_t _bucketSizeMultiplierFactor{2};
+};
+
+template<typename T1, typename T2, typename... Rest>
+std::ostream & operator<<(std::ostream &out, UnorderedMap<T1, T2, Rest...> const &map)
+{
+	if (map.empty())
 		return out;
+
+	auto start = map.begin(), end = map.end();
+
+	out << *start;
+
+	for (++start; start != end; ++start)
+		out << ", " << *start;
+
+	return out;
+}
+
+namespace flat
+{
+
+using ctrl_t = int8_t;
+
+/**
+ * Control byte of every slot, full slots store the low 7 bits
+ * of the hash (0..127), rest of the states are negative.
+ */
+enum Ctrl: ctrl_t
+{
+	EMPTY = -128,
+	DELETED = -2,
+	SENTINEL = -1
+};
+
+inline bool isFull(ctrl_t const ctrl) noexcept
+{
+	return ctrl >= 0;
+}
+
+/**
+ * Bitmask of matching slots in a group, bit i represents group slot i
+ */
+class BitMask
+{
+public:
+	explicit BitMask(uint32_t mask): _mask{mask}
+	{
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return _mask != 0;
+	}
+
+	uint32_t lowestBit() const noexcept
+	{
+		return __builtin_ctz(_mask);
+	}
+
+	BitMask & operator++() noexcept
+	{
+		_mask &= (_mask - 1);
+		return *this;
+	}
+
+private:
+	uint32_t _mask{0};
+};
+
+/**
+ * Portable group of control bytes, each half is matched as one little endian 64 bit word (SWAR).
+ * match() may report a false positive right after a real match, callers always
+ * compare the key so it only costs an extra comparison.
+ */
+struct GroupPortable
+{
+	static constexpr uint32_t WIDTH = 16;
+
+	explicit GroupPortable(ctrl_t const *ctrl) noexcept
+	{
+		std::memcpy(_ctrl, ctrl, WIDTH);
+	}
+
+	BitMask match(ctrl_t const h2) const noexcept
+	{
+		uint64_t const pattern = LSBS * static_cast<uint8_t>(h2);
+		return combine([pattern](uint64_t word){
+			uint64_t const x = word ^ pattern;
+			return (x - LSBS) & ~x & MSBS;
+		});
+	}
+
+	BitMask matchEmpty() const noexcept
+	{
+		return combine([](uint64_t word){
+			return word & (~word << 6) & MSBS;
+		});
+	}
+
+	BitMask matchEmptyOrDeleted() const noexcept
+	{
+		return combine([](uint64_t word){
+			return word & (~word << 7) & MSBS;
+		});
+	}
+
+private:
+	static constexpr uint64_t LSBS = 0x0101010101010101ull;
+	static constexpr uint64_t MSBS = 0x8080808080808080ull;
+
+	/**
+	 * Packs the high bit of every byte of both words into one 16 bit mask
+	 */
+	template<typename F>
+	BitMask combine(F &&func) const noexcept
+	{
+		constexpr uint64_t gather = 0x0102040810204080ull;
+		uint64_t const low = ((func(_ctrl[0]) >> 7) * gather) >> 56;
+		uint64_t const high = ((func(_ctrl[1]) >> 7) * gather) >> 56;
+		return BitMask(static_cast<uint32_t>(low | (high << 8)));
+	}
+
+	uint64_t _ctrl[2];
+};
+
+#if defined(__SSE2__)
+
+/**
+ * SSE2 group, 16 control bytes are compared with the hash
+ * fragment in one instruction and reduced with movemask
+ */
+struct GroupSse2
+{
+	static constexpr uint32_t WIDTH = 16;
+
+	explicit GroupSse2(ctrl_t const *ctrl) noexcept: _ctrl{_mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl))}
+	{
+	}
+
+	BitMask match(ctrl_t const h2) const noexcept
+	{
+		return BitMask(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)));
+	}
+
+	BitMask matchEmpty() const noexcept
+	{
+		return match(EMPTY);
+	}
+
+	BitMask matchEmptyOrDeleted() const noexcept
+	{
+		//Signed compare, EMPTY and DELETED are the only values below SENTINEL
+		return BitMask(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(SENTINEL), _ctrl)));
+	}
+
+	__m128i _ctrl;
+};
+
+#endif
+
+#if defined(__AVX2__)
+
+/**
+ * AVX2 group, same as SSE2 but 32 control bytes at a time
+ */
+struct GroupAvx2
+{
+	static constexpr uint32_t WIDTH = 32;
+
+	explicit GroupAvx2(ctrl_t const *ctrl) noexcept: _ctrl{_mm256_loadu_si256(reinterpret_cast<__m256i const *>(ctrl))}
+	{
+	}
+
+	BitMask match(ctrl_t const h2) const noexcept
+	{
+		return BitMask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(h2), _ctrl)));
+	}
+
+	BitMask matchEmpty() const noexcept
+	{
+		return match(EMPTY);
+	}
+
+	BitMask matchEmptyOrDeleted() const noexcept
+	{
+		return BitMask(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(SENTINEL), _ctrl)));
+	}
+
+	__m256i _ctrl;
+};
+
+#endif
+
+/**
+ * Widest group supported by the target, build with -mavx2 (or -march=native)
+ * for AVX2 and with -DFLAT_MAP_PORTABLE to force the portable version
+ */
+#if defined(FLAT_MAP_PORTABLE)
+using Group = GroupPortable;
+#elif defined(__AVX2__)
+using Group = GroupAvx2;
+#elif defined(__SSE2__)
+using Group = GroupSse2;
+#else
+using Group = GroupPortable;
+#endif
+
+/**
+ * std::hash of integers is identity, spread the bits before
+ * splitting the hash into probe position and control byte
+ */
+inline uint64_t mix(uint64_t hash) noexcept
+{
+	hash ^= hash >> 32;
+	hash *= 0x9E3779B97F4A7C15ull;
+	return hash ^ (hash >> 29);
+}
+
+}//end of namespace flat
+
+/**
+ * Open addressing (swiss table style) hash map with the UnorderedMap interface.
+ * Elements are stored inline in one slot array, a parallel array of 1 byte control
+ * metadata holds 7 bits of the hash of every full slot, so a probe compares a whole
+ * group of control bytes (16 with SSE2, 32 with AVX2) before touching any key.
+ *
+ * Capacity is always 2^n - 1, slot "capacity" is a sentinel control byte which ends
+ * iteration and the first Group::WIDTH - 1 control bytes are cloned after it so a
+ * group can be loaded from any position without wrapping.
+ * Erased slots become tombstones (DELETED) and are reused by insert.
+ * Max load factor is 7/8. A moved from map has capacity 0 and points at a shared
+ * read only empty group, it allocates again on the first insert.
+ */
+template<typename KeyType, typename MappedType, typename Hasher=std::hash<KeyType>, typename EqualTo=std::equal_to<KeyType>>
+class FlatUnorderedMap
+{
+	using ctrl_t = flat::ctrl_t;
+	using Group = flat::Group;
+
+public:
+	using ValueType = std::pair<const KeyType, MappedType>;
+
+	template<typename Value>
+	class FlatIterator
+	{
+	public:
+		FlatIterator() = default;
+
+		FlatIterator(ctrl_t const *ctrl, Value *slot) noexcept: _ctrl{ctrl}, _slot{slot}
+		{
+		}
+
+		template<typename Other, typename = std::enable_if_t<std::is_const_v<Value> && !std::is_const_v<Other>>>
+		FlatIterator(FlatIterator<Other> const &itr) noexcept: _ctrl{itr._ctrl}, _slot{itr._slot}
+		{
+		}
+
+		FlatIterator & operator++() noexcept
+		{
+			++_ctrl;
+			++_slot;
+			skipEmpty();
+			return *this;
+		}
+
+		FlatIterator operator++(int) noexcept
+		{
+			FlatIterator itr{*this};
+			++(*this);
+			return itr;
+		}
+
+		Value & operator*() const noexcept
+		{
+			return *_slot;
+		}
+
+		Value * operator->() const noexcept
+		{
+			return _slot;
+		}
+
+		bool operator==(FlatIterator const &itr) const noexcept
+		{
+			return _ctrl == itr._ctrl;
+		}
+
+		bool operator!=(FlatIterator const &itr) const noexcept
+		{
+			return ! (*this == itr);
+		}
+
+	private:
+		void skipEmpty() noexcept
+		{
+			while (*_ctrl < flat::SENTINEL)
+			{
+				++_ctrl;
+				++_slot;
+			}
+		}
+
+		ctrl_t const *_ctrl{nullptr};
+		Value *_slot{nullptr};
+
+		template<typename V>
+		friend class FlatIterator;
+
+		template<typename K, typename M, typename H, typename E>
+		friend class FlatUnorderedMap;
+	};
+
+	using Iterator = FlatIterator<ValueType>;
+	using Const_Iterator = FlatIterator<const ValueType>;
+
+	FlatUnorderedMap()
+	{
+		reserve(0);
+	}
+
+	~FlatUnorderedMap()
+	{
+		destroy();
+	}
+
+	FlatUnorderedMap(std::initializer_list<std::pair<KeyType, MappedType>> const &list)
+	{
+		reserve(list.size());
+
+		for (auto const &ele: list)
+			insert(ele.first, ele.second);
+	}
+
+	FlatUnorderedMap(FlatUnorderedMap const &map)
+	{
+		reserve(map.size());
+
+		for (auto const &ele: map)
+			insert(ele.first, ele.second);
+	}
+
+	FlatUnorderedMap(FlatUnorderedMap &&map) noexcept
+	{
+		swap(map);
+	}
+
+	FlatUnorderedMap & operator=(FlatUnorderedMap map) noexcept
+	{
+		swap(map);
+		return *this;
+	}
+
+	void swap(FlatUnorderedMap &map) noexcept
+	{
+		std::swap(_ctrl, map._ctrl);
+		std::swap(_slots, map._slots);
+		std::swap(_capacity, map._capacity);
+		std::swap(_count, map._count);
+		std::swap(_growthLeft, map._growthLeft);
+	}
+
+	Iterator begin() noexcept
+	{
+		Iterator itr(_ctrl, _slots);
+		itr.skipEmpty();
+		return itr;
+	}
+
+	Iterator end() noexcept
+	{
+		return Iterator(_ctrl + _capacity, _slots + _capacity);
+	}
+
+	Const_Iterator begin() const noexcept
+	{
+		return const_cast<FlatUnorderedMap *>(this)->begin();
+	}
+
+	Const_Iterator end() const noexcept
+	{
+		return const_cast<FlatUnorderedMap *>(this)->end();
+	}
+
+	uint32_t size() const noexcept
+	{
+		return _count;
+	}
+
+	bool empty() const noexcept
+	{
+		return _count == 0;
+	}
+
+	uint32_t capacity() const noexcept
+	{
+		return _capacity;
+	}
+
+	/**
+	 * Bytes of the map, its control bytes and slots, memory owned by keys
+	 * and values themselves (e.g. long std::string) is not included
+	 */
+	size_t memory_usage() const noexcept
+	{
+		if (_capacity == 0)
+			return sizeof(*this);
+
+		return sizeof(*this) + (_capacity + Group::WIDTH) * sizeof(ctrl_t) + size_t{_capacity} * sizeof(ValueType);
+	}
+
+	/**
+	 * Make room for size elements without rehashing
+	 */
+	void reserve(uint32_t const size)
+	{
+		uint32_t capacity = Group::WIDTH - 1;
+		while (maxElements(capacity) < size)
+			capacity = capacity * 2 + 1;
+
+		if (capacity > _capacity)
+			resize(capacity);
+	}
+
+	void clear() noexcept
+	{
+		if (_capacity == 0)
+			return;
+
+		destroySlots();
+		resetCtrl();
+		_count = 0;
+		_growthLeft = maxElements(_capacity);
+	}
+
+	std::pair<bool, Iterator> insert(KeyType const &key, MappedType const &mappedValue)
+	{
+		std::pair<bool, size_t> status = findOrPrepareInsert(key);
+
+		if (status.first)
+			new (_slots + status.second) ValueType(key, mappedValue);
+		else
+			_slots[status.second].second = mappedValue;
+
+		return {status.first, iteratorAt(status.second)};
+	}
+
+	MappedType & operator[](KeyType const &key)
+	{
+		std::pair<bool, size_t> status = findOrPrepareInsert(key);
+
+		if (status.first)
+			new (_slots + status.second) ValueType(key, MappedType{});
+
+		return _slots[status.second].second;
+	}
+
+	Iterator find(KeyType const &key)
+	{
+		size_t const index = findIndex(key);
+		return index == _capacity ? end() : iteratorAt(index);
+	}
+
+	Const_Iterator find(KeyType const &key) const
+	{
+		return const_cast<FlatUnorderedMap *>(this)->find(key);
+	}
+
+	bool erase(KeyType const &key)
+	{
+		size_t const index = findIndex(key);
+
+		if (index == _capacity)
+			return false;
+
+		eraseAt(index);
+		return true;
+	}
+
+	Iterator erase(Iterator const &keyItr)
+	{
+		Iterator itr{keyItr};
+		++itr;
+		eraseAt(keyItr._slot - _slots);
+		return itr;
+	}
+
+	std::ostream & printDebug(std::ostream &out) const
+	{
+		out << "Capacity: " << _capacity << ", Count: " << _count << ", Growthleft: " << _growthLeft << " => \n";
+		for (uint32_t i = 0; i < _capacity; ++i)
+		{
+			out << "[" << i << ":" << static_cast<int32_t>(_ctrl[i]) << "] ";
+			if (flat::isFull(_ctrl[i]))
+				out << _slots[i];
+			out << std::endl;
+		}
+		return out;
+	}
+
+private:
+	static uint32_t maxElements(uint32_t const capacity) noexcept
+	{
+		return capacity - capacity / 8;
+	}
+
+	uint64_t hash(KeyType const &key) const noexcept
+	{
+		return flat::mix(_hash(key));
+	}
+
+	static ctrl_t h2(uint64_t const hash) noexcept
+	{
+		return static_cast<ctrl_t>(hash & 0x7F);
+	}
+
+	static size_t h1(uint64_t const hash) noexcept
+	{
+		return hash >> 7;
+	}
+
+	Iterator iteratorAt(size_t const index) noexcept
+	{
+		return Iterator(_ctrl + index, _slots + index);
+	}
+
+	/**
+	 * return: index of the key or _capacity if not found
+	 */
+	size_t findIndex(KeyType const &key) const
+	{
+		return findIndex(key, hash(key));
+	}
+
+	size_t findIndex(KeyType const &key, uint64_t const hashValue) const
+	{
+		ctrl_t const fragment = h2(hashValue);
+
+		for (size_t pos = h1(hashValue) & _capacity, stride = 0; ; )
+		{
+			Group const group(_ctrl + pos);
+
+			for (flat::BitMask match = group.match(fragment); match; ++match)
+			{
+				size_t const index = (pos + match.lowestBit()) & _capacity;
+				if (_equal(_slots[index].first, key))
+					return index;
+			}
+
+			if (group.matchEmpty())
+				return _capacity;
+
+			stride += Group::WIDTH;
+			pos = (pos + stride) & _capacity;
+		}
+	}
+
+	size_t findFirstNonFull(uint64_t const hashValue) const noexcept
+	{
+		for (size_t pos = h1(hashValue) & _capacity, stride = 0; ; )
+		{
+			flat::BitMask mask = Group(_ctrl + pos).matchEmptyOrDeleted();
+
+			if (mask)
+				return (pos + mask.lowestBit()) & _capacity;
+
+			stride += Group::WIDTH;
+			pos = (pos + stride) & _capacity;
+		}
+	}
+
+	/**
+	 * return: {true, free slot index} if key is not present otherwise {false, key index}.
+	 * Caller must construct the element in the free slot.
+	 */
+	std::pair<bool, size_t> findOrPrepareInsert(KeyType const &key)
+	{
+		uint64_t const hashValue = hash(key);
+		size_t const index = findIndex(key, hashValue);
+
+		if (index != _capacity)
+			return {false, index};
+
+		size_t target = findFirstNonFull(hashValue);
+
+		if (_growthLeft == 0 && _ctrl[target] != flat::DELETED)
+		{
+			//Rehash in place when tombstones take most of the space, otherwise grow
+			if (_capacity == 0)
+				resize(Group::WIDTH - 1);
+			else
+				resize(_count * 2 < maxElements(_capacity) ? _capacity : _capacity * 2 + 1);
+			target = findFirstNonFull(hashValue);
+		}
+
+		if (_ctrl[target] == flat::EMPTY)
+			--_growthLeft;
+
+		setCtrl(target, h2(hashValue));
+		++_count;
+
+		return {true, target};
+	}
+
+	void eraseAt(size_t const index)
+	{
+		_slots[index].~ValueType();
+		setCtrl(index, flat::DELETED);
+		--_count;
+	}
+
+	void setCtrl(size_t const index, ctrl_t const value) noexcept
+	{
+		_ctrl[index] = value;
+
+		if (index < Group::WIDTH - 1)
+			_ctrl[_capacity + 1 + index] = value;
+	}
+
+	void resetCtrl() noexcept
+	{
+		std::memset(_ctrl, flat::EMPTY, _capacity + Group::WIDTH);
+		_ctrl[_capacity] = flat::SENTINEL;
+	}
+
+	void resize(uint32_t const newCapacity)
+	{
+		ctrl_t *oldCtrl = _ctrl;
+		ValueType *oldSlots = _slots;
+		uint32_t const oldCapacity = _capacity;
+
+		_ctrl = new ctrl_t[newCapacity + Group::WIDTH];
+		_slots = std::allocator<ValueType>().allocate(newCapacity);
+		_capacity = newCapacity;
+		_growthLeft = maxElements(_capacity) - _count;
+		resetCtrl();
+
+		if (oldCapacity == 0)
+			return;
+
+		for (uint32_t i = 0; i < oldCapacity; ++i)
+		{
+			if (flat::isFull(oldCtrl[i]))
+			{
+				uint64_t const hashValue = hash(oldSlots[i].first);
+				size_t const target = findFirstNonFull(hashValue);
+
+				setCtrl(target, h2(hashValue));
+				new (_slots + target) ValueType(std::move(oldSlots[i]));
+				oldSlots[i].~ValueType();
+			}
+		}
+
+		delete [] oldCtrl;
+		std::allocator<ValueType>().deallocate(oldSlots, oldCapacity);
+	}
+
+	void destroySlots() noexcept
+	{
+		if constexpr (! std::is_trivially_destructible_v<ValueType>)
+		{
+			for (uint32_t i = 0; i < _capacity; ++i)
+				if (flat::isFull(_ctrl[i]))
+					_slots[i].~ValueType();
+		}
+	}
+
+	void destroy() noexcept
+	{
+		if (_capacity == 0)
+			return;
+
+		destroySlots();
+		delete [] _ctrl;
+		std::allocator<ValueType>().deallocate(_slots, _capacity);
+		_ctrl = emptyCtrl();
+		_slots = nullptr;
+		_capacity = 0;
+	}
+
+	/**
+	 * Control bytes of a map without slots: the sentinel followed by empty bytes,
+	 * a probe stops at the first group and iteration ends right away.
+	 * Shared by every capacity 0 map and never written.
+	 */
+	static ctrl_t * emptyCtrl() noexcept
+	{
+		struct EmptyGroup
+		{
+			EmptyGroup() noexcept
+			{
+				std::memset(_ctrl, flat::EMPTY, Group::WIDTH);
+				_ctrl[0] = flat::SENTINEL;
+			}
+
+			ctrl_t _ctrl[Group::WIDTH];
+		};
+
+		static EmptyGroup const group;
+		return const_cast<ctrl_t *>(group._ctrl);
+	}
+
+	ctrl_t *_ctrl{emptyCtrl()};
+	ValueType *_slots{nullptr};
+	uint32_t _capacity{0};
+	uint32_t _count{0};
+	uint32_t _growthLeft{0};
+	Hasher _hash{};
+	EqualTo _equal{};
+};
+
+template<typename T1, typename T2>
+std::ostream & operator<<(std::ostream &out, FlatUnorderedMap<T1, T2> const &map)
+{
+	if (map.empty())
+		return out;
+
+	auto start = map.begin(), end = map.end();
+
+	out << *start;
+
+	for (++start; start != end; ++start)
+		out << ", " << *start;
+
+	return out;
+}
+
+/**
+ * Chained hash map with a compact layout for large maps of small keys and values.
+ * Elements are stored densely in one array in insertion order, the chain links
+ * are uint32_t indices in a parallel array and every bucket is a single uint32_t
+ * index of its first element. An element costs sizeof(ValueType) + 4 bytes plus
+ * 4 to 8 bytes of bucket heads, 16 to 20 bytes for int -> int where UnorderedMap
+ * needs a 24 byte node and 24 to 48 bytes of buckets.
+ *
+ * Hashes are not cached, growing the bucket array hashes every key again, so it
+ * suits keys which hash cheaply. Iteration walks the dense array.
+ * Erase moves the last element into the hole, which invalidates iterators and
+ * references to the last element. Max load factor is 1, at most 2^31 elements.
+ * A moved from map has no arrays and points at shared read only empty bucket
+ * heads, it allocates again on the first insert.
+ */
+template<typename KeyType, typename MappedType, typename Hasher=std::hash<KeyType>, typename EqualTo=std::equal_to<KeyType>>
+class CompactUnorderedMap
+{
+public:
+	using ValueType = std::pair<const KeyType, MappedType>;
+	using Iterator = ValueType *;
+	using Const_Iterator = ValueType const *;
+
+	CompactUnorderedMap()
+	{
+		reserve(0);
+	}
+
+	~CompactUnorderedMap()
+	{
+		destroy();
+	}
+
+	CompactUnorderedMap(std::initializer_list<std::pair<KeyType, MappedType>> const &list)
+	{
+		reserve(list.size());
+
+		for (auto const &ele: list)
+			insert(ele.first, ele.second);
+	}
+
+	CompactUnorderedMap(CompactUnorderedMap const &map)
+	{
+		reserve(map.size());
+
+		for (auto const &ele: map)
+			insert(ele.first, ele.second);
+	}
+
+	CompactUnorderedMap(CompactUnorderedMap &&map) noexcept
+	{
+		swap(map);
+	}
+
+	CompactUnorderedMap & operator=(CompactUnorderedMap map) noexcept
+	{
+		swap(map);
+		return *this;
+	}
+
+	void swap(CompactUnorderedMap &map) noexcept
+	{
+		std::swap(_values, map._values);
+		std::swap(_next, map._next);
+		std::swap(_heads, map._heads);
+		std::swap(_capacity, map._capacity);
+		std::swap(_count, map._count);
+		std::swap(_bucketCount, map._bucketCount);
+		std::swap(_shift, map._shift);
+	}
+
+	Iterator begin() noexcept
+	{
+		return _values;
+	}
+
+	Iterator end() noexcept
+	{
+		return _values + _count;
+	}
+
+	Const_Iterator begin() const noexcept
+	{
+		return _values;
+	}
+
+	Const_Iterator end() const noexcept
+	{
+		return _values + _count;
+	}
+
+	uint32_t size() const noexcept
+	{
+		return _count;
+	}
+
+	bool empty() const noexcept
+	{
+		return _count == 0;
+	}
+
+	/**
+	 * Room for exactly size elements and buckets for them, no growth until
+	 * size is exceeded
+	 */
+	void reserve(uint32_t const size)
+	{
+		if (_values == nullptr || size > _capacity)
+			resizeValues(std::max<uint32_t>(size, 1));
+
+		uint32_t bucketCount = 2;
+		while (bucketCount < size)
+			bucketCount <<= 1;
+
+		if (bucketCount > _bucketCount)
+			resizeBuckets(bucketCount);
+	}
+
+	void clear() noexcept
+	{
+		destroyValues();
+		std::fill(_heads, _heads + _bucketCount, NIL);
+		_count = 0;
+	}
+
+	std::pair<bool, Iterator> insert(KeyType const &key, MappedType const &mappedValue)
+	{
+		std::pair<bool, uint32_t> status = findOrPrepareInsert(key);
+
+		if (status.first)
+			new (_values + status.second) ValueType(key, mappedValue);
+		else
+			_values[status.second].second = mappedValue;
+
+		return {status.first, _values + status.second};
+	}
+
+	MappedType & operator[](KeyType const &key)
+	{
+		std::pair<bool, uint32_t> status = findOrPrepareInsert(key);
+
+		if (status.first)
+			new (_values + status.second) ValueType(key, MappedType{});
+
+		return _values[status.second].second;
+	}
+
+	Iterator find(KeyType const &key) noexcept
+	{
+		uint32_t const index = findIndex(key);
+		return index == NIL ? end() : _values + index;
+	}
+
+	Const_Iterator find(KeyType const &key) const noexcept
+	{
+		return const_cast<CompactUnorderedMap *>(this)->find(key);
+	}
+
+	bool erase(KeyType const &key)
+	{
+		uint32_t *link = &_heads[bucketOf(key)];
+
+		for (; *link != NIL; link = &_next[*link])
+		{
+			if (_equal(_values[*link].first, key))
+			{
+				eraseAt(link);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * return: iterator to the element which took the place of the erased one
+	 */
+	Iterator erase(Iterator const &keyItr)
+	{
+		uint32_t const index = keyItr - _values;
+		uint32_t *link = &_heads[bucketOf(keyItr->first)];
+
+		while (*link != index)
+			link = &_next[*link];
+
+		eraseAt(link);
+		return _values + index;
+	}
+
+	/**
+	 * Bytes of the map and its arrays, memory owned by keys and values
+	 * themselves (e.g. long std::string) is not included
+	 */
+	size_t memory_usage() const noexcept
+	{
+		return sizeof(*this) + size_t{_capacity} * (sizeof(ValueType) + sizeof(uint32_t)) + size_t{_bucketCount} * sizeof(uint32_t);
+	}
+
+private:
+	static constexpr uint32_t NIL = ~uint32_t{0};
+
+	/**
+	 * High bits of the mixed hash, there are at least 2 buckets so _shift < 64
+	 */
+	uint32_t bucketOf(KeyType const &key) const noexcept
+	{
+		return flat::mix(_hash(key)) >> _shift;
+	}
+
+	uint32_t findIndex(KeyType const &key) const noexcept
+	{
+		uint32_t index = _heads[bucketOf(key)];
+
+		while (index != NIL && ! _equal(_values[index].first, key))
+			index = _next[index];
+
+		return index;
+	}
+
+	/**
+	 * return: {true, index to construct the element at} if key is not present
+	 * otherwise {false, key index}. The new index is already linked.
+	 */
+	std::pair<bool, uint32_t> findOrPrepareInsert(KeyType const &key)
+	{
+		uint32_t const index = findIndex(key);
+
+		if (index != NIL)
+			return {false, index};
+
+		if (_count == _capacity)
+			resizeValues(_capacity == 0 ? 1 : _capacity * 2);
+
+		if (_count == _bucketCount)
+			resizeBuckets(_bucketCount == 0 ? 2 : _bucketCount * 2);
+
+		uint32_t const bucket = bucketOf(key);
+		_next[_count] = _heads[bucket];
+		_heads[bucket] = _count;
+
+		return {true, _count++};
+	}
+
+	/**
+	 * link points to the index of the element to erase, the last element is
+	 * moved into its place
+	 */
+	void eraseAt(uint32_t *link)
+	{
+		uint32_t const index = *link;
+		uint32_t const last = _count - 1;
+
+		*link = _next[index];
+		_values[index].~ValueType();
+
+		if (index != last)
+		{
+			uint32_t *lastLink = &_heads[bucketOf(_values[last].first)];
+			while (*lastLink != last)
+				lastLink = &_next[*lastLink];
+
+			*lastLink = index;
+			_next[index] = _next[last];
+			new (_values + index) ValueType(std::move(_values[last]));
+			_values[last].~ValueType();
+		}
+
+		--_count;
+	}
+
+	void resizeValues(uint32_t const newCapacity)
+	{
+		ValueType *values = std::allocator<ValueType>().allocate(newCapacity);
+		uint32_t *next = new uint32_t[newCapacity];
+
+		for (uint32_t i = 0; i < _count; ++i)
+		{
+			new (values + i) ValueType(std::move(_values[i]));
+			_values[i].~ValueType();
+		}
+
+		std::copy(_next, _next + _count, next);
+
+		if (_values != nullptr)
+			std::allocator<ValueType>().deallocate(_values, _capacity);
+		delete [] _next;
+
+		_values = values;
+		_next = next;
+		_capacity = newCapacity;
+	}
+
+	/**
+	 * Links every element again, newest first like insert does
+	 */
+	void resizeBuckets(uint32_t const newBucketCount)
+	{
+		uint32_t *heads = new uint32_t[newBucketCount];
+
+		if (_bucketCount != 0)
+			delete [] _heads;
+
+		_heads = heads;
+		_bucketCount = newBucketCount;
+		_shift = 64 - __builtin_ctz(newBucketCount);
+
+		std::fill(_heads, _heads + _bucketCount, NIL);
+
+		for (uint32_t i = 0; i < _count; ++i)
+		{
+			uint32_t const bucket = bucketOf(_values[i].first);
+			_next[i] = _heads[bucket];
+			_heads[bucket] = i;
+		}
+	}
+
+	void destroyValues() noexcept
+	{
+		if constexpr (! std::is_trivially_destructible_v<ValueType>)
+		{
+			for (uint32_t i = 0; i < _count; ++i)
+				_values[i].~ValueType();
+		}
+	}
+
+	void destroy() noexcept
+	{
+		if (_values != nullptr)
+		{
+			destroyValues();
+			std::allocator<ValueType>().deallocate(_values, _capacity);
+			delete [] _next;
+		}
+
+		if (_bucketCount != 0)
+			delete [] _heads;
+
+		_values = nullptr;
+		_next = nullptr;
+		_heads = emptyHeads();
+		_capacity = _count = _bucketCount = 0;
+		_shift = 63;
+	}
+
+	/**
+	 * Bucket heads of a map without buckets, two so bucketOf() stays in range
+	 * with _shift 63. Shared by every such map and never written.
+	 */
+	static uint32_t * emptyHeads() noexcept
+	{
+		static uint32_t const heads[2] = {NIL, NIL};
+		return const_cast<uint32_t *>(heads);
+	}
+
+	ValueType *_values{nullptr};
+	uint32_t *_next{nullptr};
+	uint32_t *_heads{emptyHeads()};
+	uint32_t _capacity{0};
+	uint32_t _count{0};
+	uint32_t _bucketCount{0};
+	uint32_t _shift{63};
+	Hasher _hash{};
+	EqualTo _equal{};
+};
+
+template<typename T1, typename T2>
+std::ostream & operator<<(std::ostream &out, CompactUnorderedMap<T1, T2> const &map)
+{
+	if (map.empty())
+		return out;
+
+	auto start = map.begin(), end = map.end();
+
+	out << *start;
+
+	for (++start; start != end; ++start)
+		out << ", " << *start;
+
+	return out;
+}
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace epoch
+{
+
+/**
+ * Epoch based reclamation for structures read without locks. A reader pins the
+ * global epoch in one of SLOTS slots for the length of an operation. Memory a
+ * writer unlinks is retired with the epoch read after unlinking it and can be
+ * freed once the global epoch is 2 past that: the epoch only advances when every
+ * pinned slot holds the current epoch, so no reader which could still reach the
+ * memory is pinned any more.
+ *
+ * Users load and unlink the shared pointers with memory_order_seq_cst like the
+ * pin itself, so either a writer sees the pin or the reader sees the unlink.
+ */
+class Domain
+{
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> _pinned;
+	};
+
+public:
+	/**
+	 * Epoch pinned by the calling thread, unpinned by the destructor
+	 */
+	class Guard
+	{
+	public:
+		explicit Guard(Slot &slot) noexcept: _slot{slot}
+		{
+		}
+
+		Guard(Guard const &) = delete;
+		Guard & operator=(Guard const &) = delete;
+
+		~Guard()
+		{
+			_slot._pinned.store(FREE, std::memory_order_release);
+		}
+
+	private:
+		Slot &_slot;
+	};
+
+	Domain() noexcept
+	{
+		for (auto &slot: _slots)
+			slot._pinned.store(FREE, std::memory_order_relaxed);
+	}
+
+	Domain(Domain const &) = delete;
+	Domain & operator=(Domain const &) = delete;
+
+	/**
+	 * Takes a free slot, first the one this thread used last. Slots are taken
+	 * from the front, so writers only scan as many as were pinned at once.
+	 * Yields when more threads than slots are pinned at the same time.
+	 */
+	Guard pin() noexcept
+	{
+		for (uint32_t index = _hint; ; index = (index + 1) % SLOTS)
+		{
+			Slot &slot = _slots[index];
+
+			if (slot._pinned.load(std::memory_order_relaxed) != FREE)
+			{
+				if ((index + 1) % SLOTS == _hint)
+					std::this_thread::yield();
+				continue;
+			}
+
+			//Slot is scanned from now on, raised before the slot is pinned
+			for (uint32_t used = _used.load(std::memory_order_seq_cst); used <= index; )
+				if (_used.compare_exchange_weak(used, index + 1, std::memory_order_seq_cst))
+					break;
+
+			uint64_t expected = FREE;
+			uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+
+			if (slot._pinned.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst))
+			{
+				//Epoch may have advanced before the slot was visible to writers
+				for (uint64_t current; (current = _epoch.load(std::memory_order_seq_cst)) != epoch; epoch = current)
+					slot._pinned.store(current, std::memory_order_seq_cst);
+
+				_hint = index;
+				return Guard{slot};
+			}
+
+			if ((index + 1) % SLOTS == _hint)
+				std::this_thread::yield();
+		}
+	}
+
+	/**
+	 * Epoch to retire memory with, called after the memory is unlinked
+	 */
+	uint64_t retireEpoch() const noexcept
+	{
+		return _epoch.load(std::memory_order_seq_cst);
+	}
+
+	/**
+	 * Advances the global epoch if every pinned reader is in it
+	 */
+	void tryAdvance() noexcept
+	{
+		uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+		uint32_t const used = _used.load(std::memory_order_seq_cst);
+
+		for (uint32_t i = 0; i < used; ++i)
+		{
+			uint64_t const pinned = _slots[i]._pinned.load(std::memory_order_seq_cst);
+			if (pinned != FREE && pinned != epoch)
+				return;
+		}
+
+		_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+	}
+
+	/**
+	 * No reader can reach memory retired in epoch any more
+	 */
+	bool reclaimable(uint64_t const epoch) const noexcept
+	{
+		return epoch + 2 <= _epoch.load(std::memory_order_seq_cst);
+	}
+
+private:
+	static constexpr uint32_t SLOTS = 128;
+	static constexpr uint64_t FREE = 0;
+
+	static inline thread_local uint32_t _hint{0};
+
+	alignas(64) std::atomic<uint64_t> _epoch{1};
+	std::atomic<uint32_t> _used{0};
+	Slot _slots[SLOTS];
+};
+
+}
+
+/**
+ * Thread safe hash map made of ShardCount shards, shard is selected by the high
+ * bits of the mixed hash and the bucket within the shard by the low bits. Each
+ * shard is a chained table whose buckets and links are atomic pointers, writers
+ * of a shard serialize on its mutex while readers take no lock at all and walk
+ * the chains inside an epoch::Domain pin.
+ *
+ * Key and value of a published node are never modified, only its link. Insert
+ * links a new node at the end of its chain, updating a value replaces the node
+ * by a modified copy and erase unlinks it. Replaced nodes are retired to the
+ * shard and freed once no reader can be on them, so readers see the old or the
+ * new element and never a torn one. KeyType and MappedType must be copy
+ * constructible.
+ *
+ * Growing a shard relinks its nodes into a table with twice the buckets while
+ * the shard version is odd. Chains stay null terminated during the relink but a
+ * reader may be moved to another chain, so a lookup which misses while a grow
+ * is in progress (version odd or changed) is retried. Hits never wait.
+ *
+ * There are no iterators, found values are copied out or accessed by a callback.
+ * The callback of visit() holds no lock and may use the map, the callbacks of
+ * update() and forEach() hold a shard lock and must not.
+ */
+template<typename KeyType, typename MappedType, typename Hasher=std::hash<KeyType>, typename EqualTo=std::equal_to<KeyType>, uint32_t ShardCount=64>
+class ConcurrentUnorderedMap
+{
+	static_assert(ShardCount >= 2 && (ShardCount & (ShardCount - 1)) == 0, "Shard count is not power of 2");
+
+public:
+	using ValueType = std::pair<const KeyType, MappedType>;
+
+	ConcurrentUnorderedMap()
+	{
+		for (auto &shard: _shards)
+			shard._table.store(new Table(MIN_BUCKETS), std::memory_order_relaxed);
+	}
+
+	/**
+	 * No other thread may use the map any more
+	 */
+	~ConcurrentUnorderedMap()
+	{
+		for (auto &shard: _shards)
+		{
+			Table *table = shard._table.load(std::memory_order_relaxed);
+
+			for (uint32_t i = 0; i <= table->_mask; ++i)
+			{
+				for (Node *node = table->_buckets[i].load(std::memory_order_relaxed), *next; node != nullptr; node = next)
+				{
+					next = node->_next.load(std::memory_order_relaxed);
+					delete node;
+				}
+			}
+
+			delete table;
+
+			for (auto const &retired: shard._retired)
+				retired._deleter(retired._ptr);
+		}
+	}
+
+	ConcurrentUnorderedMap(ConcurrentUnorderedMap const &) = delete;
+	ConcurrentUnorderedMap & operator=(ConcurrentUnorderedMap const &) = delete;
+
+	/**
+	 * Make room for size elements, assuming they spread evenly over the shards
+	 */
+	void reserve(uint32_t const size)
+	{
+		uint32_t const bucketCount = bucketCountFor(size / ShardCount + 1);
+
+		for (auto &shard: _shards)
+		{
+			std::unique_lock<std::mutex> lock{shard._mutex};
+
+			if (bucketCount > shard._table.load(std::memory_order_relaxed)->_mask + 1)
+				grow(shard, bucketCount);
+		}
+	}
+
+	/**
+	 * Inserts or updates the mapped value of key
+	 * return: true if key was inserted
+	 */
+	bool insert(KeyType const &key, MappedType const &mappedValue)
+	{
+		uint64_t const hash = flat::mix(_hash(key));
+		Shard &shard = _shards[hash >> SHARD_SHIFT];
+		std::unique_lock<std::mutex> lock{shard._mutex};
+
+		std::atomic<Node *> *link = &linkOf(shard, key, hash);
+		Node *node = link->load(std::memory_order_relaxed);
+
+		if (node != nullptr)
+		{
+			replace(shard, *link, new Node(hash, node->_value.first, mappedValue));
+			return false;
+		}
+
+		uint32_t const count = shard._count.load(std::memory_order_relaxed);
+		Table const *table = shard._table.load(std::memory_order_relaxed);
+
+		if (count + 1 > table->_mask + 1)
+		{
+			grow(shard, (table->_mask + 1) * 2);
+			link = &linkOf(shard, key, hash);
+		}
+
+		link->store(new Node(hash, key, mappedValue), std::memory_order_seq_cst);
+		shard._count.store(count + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool erase(KeyType const &key)
+	{
+		uint64_t const hash = flat::mix(_hash(key));
+		Shard &shard = _shards[hash >> SHARD_SHIFT];
+		std::unique_lock<std::mutex> lock{shard._mutex};
+
+		std::atomic<Node *> &link = linkOf(shard, key, hash);
+		Node *node = link.load(std::memory_order_relaxed);
+
+		if (node == nullptr)
+			return false;
+
+		//Readers on node still find the rest of the chain through it
+		link.store(node->_next.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+		shard._count.store(shard._count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+		retire(shard, node, deleteNode);
+		return true;
+	}
+
+	/**
+	 * Copies mapped value of key to mappedValue
+	 */
+	bool find(KeyType const &key, MappedType &mappedValue) const
+	{
+		return visit(key, [&mappedValue](MappedType const &value){
+			mappedValue = value;
+		});
+	}
+
+	bool contains(KeyType const &key) const
+	{
+		return visit(key, [](MappedType const &){});
+	}
+
+	/**
+	 * Calls func(MappedType const &) without any lock, the value stays
+	 * valid until func returns even if the key is updated or erased
+	 */
+	template<typename F>
+	bool visit(KeyType const &key, F &&func) const
+	{
+		uint64_t const hash = flat::mix(_hash(key));
+		Shard const &shard = _shards[hash >> SHARD_SHIFT];
+		auto const guard = _domain.pin();
+
+		for (;;)
+		{
+			uint32_t const version = shard._version.load(std::memory_order_seq_cst);
+			Table const *table = shard._table.load(std::memory_order_seq_cst);
+
+			for (Node const *node = table->bucket(hash).load(std::memory_order_seq_cst); node != nullptr; node = node->_next.load(std::memory_order_seq_cst))
+			{
+				if (node->_hash == hash && _equal(node->_value.first, key))
+				{
+					func(node->_value.second);
+					return true;
+				}
+			}
+
+			if (version == shard._version.load(std::memory_order_seq_cst))
+			{
+				if ((version & 1) == 0)
+					return false;
+
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/**
+	 * Calls func(MappedType &) on a copy of the mapped value under the shard
+	 * lock, the copy replaces the element when func returns
+	 */
+	template<typename F>
+	bool update(KeyType const &key, F &&func)
+	{
+		uint64_t const hash = flat::mix(_hash(key));
+		Shard &shard = _shards[hash >> SHARD_SHIFT];
+		std::unique_lock<std::mutex> lock{shard._mutex};
+
+		std::atomic<Node *> &link = linkOf(shard, key, hash);
+		Node *node = link.load(std::memory_order_relaxed);
+
+		if (node == nullptr)
+			return false;
+
+		std::unique_ptr<Node> copy{new Node(hash, node->_value)};
+		func(copy->_value.second);
+		replace(shard, link, copy.release());
+		return true;
+	}
+
+	/**
+	 * Calls func(ValueType const &) for every element under the lock of its
+	 * shard, one shard at a time. Not a snapshot, shards which are not
+	 * locked yet can still change.
+	 */
+	template<typename F>
+	void forEach(F &&func) const
+	{
+		for (auto const &shard: _shards)
+		{
+			std::unique_lock<std::mutex> lock{shard._mutex};
+			Table const *table = shard._table.load(std::memory_order_relaxed);
+
+			for (uint32_t i = 0; i <= table->_mask; ++i)
+				for (Node const *node = table->_buckets[i].load(std::memory_order_relaxed); node != nullptr; node = node->_next.load(std::memory_order_relaxed))
+					func(node->_value);
+		}
+	}
+
+	uint32_t size() const
+	{
+		uint32_t count = 0;
+		for (auto const &shard: _shards)
+			count += shard._count.load(std::memory_order_relaxed);
+		return count;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+private:
+	struct Node
+	{
+		template<typename... Args>
+		explicit Node(uint64_t const hash, Args&&... args): _hash{hash}, _value(std::forward<Args>(args)...)
+		{
+		}
+
+		uint64_t const _hash;
+		ValueType _value;
+		std::atomic<Node *> _next{nullptr};
+	};
+
+	/**
+	 * Power of two buckets, the nodes are owned by the map
+	 */
+	struct Table
+	{
+		explicit Table(uint32_t const bucketCount): _mask{bucketCount - 1}, _buckets{new std::atomic<Node *>[bucketCount]}
+		{
+			for (uint32_t i = 0; i < bucketCount; ++i)
+				_buckets[i].store(nullptr, std::memory_order_relaxed);
+		}
+
+		std::atomic<Node *> & bucket(uint64_t const hash) const noexcept
+		{
+			return _buckets[hash & _mask];
+		}
+
+		uint32_t const _mask;
+		std::unique_ptr<std::atomic<Node *>[]> const _buckets;
+	};
+
+	struct Retired
+	{
+		void *_ptr;
+		void (*_deleter)(void *);
+		uint64_t _epoch;
+	};
+
+	struct Shard
+	{
+		//Loaded by every reader, stored only when the shard grows
+		alignas(64) std::atomic<Table *> _table{nullptr};
+		std::atomic<uint32_t> _version{0};
+
+		//Writers only, under _mutex
+		alignas(64) mutable std::mutex _mutex;
+		std::atomic<uint32_t> _count{0};
+		std::vector<Retired> _retired;
+		size_t _reclaimAt{RECLAIM_THRESHOLD};
+	};
+
+	static constexpr uint32_t SHARD_SHIFT = 64 - __builtin_ctz(ShardCount);
+	static constexpr uint32_t MIN_BUCKETS = 8;
+	static constexpr size_t RECLAIM_THRESHOLD = 64;
+
+	static uint32_t bucketCountFor(uint32_t const size) noexcept
+	{
+		uint32_t count = MIN_BUCKETS;
+		while (count < size)
+			count <<= 1;
+		return count;
+	}
+
+	static void deleteNode(void *ptr)
+	{
+		delete static_cast<Node *>(ptr);
+	}
+
+	static void deleteTable(void *ptr)
+	{
+		delete static_cast<Table *>(ptr);
+	}
+
+	/**
+	 * Link which points to the node of key, the null link at the end of its
+	 * chain if key is not present. Shard lock is held.
+	 */
+	std::atomic<Node *> & linkOf(Shard &shard, KeyType const &key, uint64_t const hash)
+	{
+		std::atomic<Node *> *link = &shard._table.load(std::memory_order_relaxed)->bucket(hash);
+
+		for (Node *node = link->load(std::memory_order_relaxed); node != nullptr; node = link->load(std::memory_order_relaxed))
+		{
+			if (node->_hash == hash && _equal(node->_value.first, key))
+				break;
+
+			link = &node->_next;
+		}
+
+		return *link;
+	}
+
+	/**
+	 * Publishes node in place of the one link points to, shard lock is held
+	 */
+	void replace(Shard &shard, std::atomic<Node *> &link, Node *node)
+	{
+		Node *old = link.load(std::memory_order_relaxed);
+		node->_next.store(old->_next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		link.store(node, std::memory_order_seq_cst);
+		retire(shard, old, deleteNode);
+	}
+
+	/**
+	 * Relinks every node into a new table under an odd version. A moved node
+	 * points to nodes moved before it, so a reader on an old chain ends up on
+	 * a null terminated new one and never loops. Shard lock is held.
+	 */
+	void grow(Shard &shard, uint32_t const bucketCount)
+	{
+		Table *old = shard._table.load(std::memory_order_relaxed);
+		Table *table = new Table(bucketCount);
+		uint32_t const version = shard._version.load(std::memory_order_relaxed);
+
+		shard._version.store(version + 1, std::memory_order_seq_cst);
+
+		for (uint32_t i = 0; i <= old->_mask; ++i)
+		{
+			for (Node *node = old->_buckets[i].load(std::memory_order_relaxed), *next; node != nullptr; node = next)
+			{
+				next = node->_next.load(std::memory_order_relaxed);
+				std::atomic<Node *> &bucket = table->bucket(node->_hash);
+
+				//New table is not published yet, its buckets are only read through moved nodes
+				node->_next.store(bucket.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+				bucket.store(node, std::memory_order_relaxed);
+			}
+		}
+
+		shard._table.store(table, std::memory_order_seq_cst);
+		shard._version.store(version + 2, std::memory_order_seq_cst);
+		retire(shard, old, deleteTable);
+	}
+
+	/**
+	 * Frees ptr once no reader can reach it, the shard lock is held. Retired
+	 * memory is scanned when it doubled since the last scan, so readers pinned
+	 * for long don't make every write scan.
+	 */
+	void retire(Shard &shard, void *ptr, void (*deleter)(void *))
+	{
+		shard._retired.push_back({ptr, deleter, _domain.retireEpoch()});
+
+		if (shard._retired.size() < shard._reclaimAt)
+			return;
+
+		//Memory retired in the current epoch needs two advances, both succeed when no reader is pinned
+		_domain.tryAdvance();
+		_domain.tryAdvance();
+
+		auto reclaimed = std::partition(shard._retired.begin(), shard._retired.end(), [this](Retired const &retired){
+			return ! _domain.reclaimable(retired._epoch);
+		});
+
+		for (auto itr = reclaimed; itr != shard._retired.end(); ++itr)
+			itr->_deleter(itr->_ptr);
+
+		shard._retired.erase(reclaimed, shard._retired.end());
+		shard._reclaimAt = std::max(RECLAIM_THRESHOLD, shard._retired.size() * 2);
+	}
+
+	std::array<Shard, ShardCount> _shards;
+	mutable epoch::Domain _domain;
+	Hasher _hash{};
+	EqualTo _equal{};
+};
+
+#include <cstddef>
+#include <fstream>
+#include <ios>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace snapshot
+{
+	/**
+	 * FNV-1a over the bytes of the key, finished by flat::mix. Unlike std::hash
+	 * it is the same in every build, a snapshot written by one binary can be
+	 * read by another.
+	 */
+	inline uint64_t hashBytes(void const *data, size_t const length) noexcept
+	{
+		auto const *byte = static_cast<unsigned char const *>(data);
+		uint64_t hash = 0xcbf29ce484222325ull;
+
+		for (size_t i = 0; i < length; ++i)
+			hash = (hash ^ byte[i]) * 0x100000001b3ull;
+
+		return flat::mix(hash);
+	}
+
+	/**
+	 * How a key or mapped type is laid out in the file.
+	 * Trivially copyable types are stored inline, View is a copy.
+	 */
+	template<typename T, typename=void>
+	struct Traits
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "snapshot supports trivially copyable types and std::string");
+
+		using Stored = T;
+		using View = T;
+
+		static Stored store(T const &value, std::string &)
+		{
+			return value;
+		}
+
+		static View view(Stored const &stored, char const *)
+		{
+			return stored;
+		}
+
+		static bool valid(Stored const &, uint64_t)
+		{
+			return true;
+		}
+
+		/**
+		 * Only instantiated for keys. Equal keys must have equal bytes, so
+		 * padding and floating point (-0.0 == 0.0) keys are rejected.
+		 */
+		static uint64_t hash(View const &value)
+		{
+			static_assert(std::has_unique_object_representations_v<T>, "snapshot key must have unique object representations, no padding or floating point");
+
+			return hashBytes(&value, sizeof(T));
+		}
+	};
+
+	/**
+	 * std::string is stored as offset and length into the string blob at the
+	 * end of the file, View is a std::string_view into the mapping.
+	 */
+	template<>
+	struct Traits<std::string>
+	{
+		struct Stored
+		{
+			uint64_t _offset;
+			uint64_t _length;
+		};
+
+		using View = std::string_view;
+
+		static Stored store(std::string const &value, std::string &blob)
+		{
+			Stored stored{blob.size(), value.size()};
+			blob.append(value);
+			return stored;
+		}
+
+		static View view(Stored const &stored, char const *blob)
+		{
+			return View(blob + stored._offset, stored._length);
+		}
+
+		/**
+		 * String lies within a blob of blobSize bytes
+		 */
+		static bool valid(Stored const &stored, uint64_t const blobSize)
+		{
+			return stored._offset <= blobSize && stored._length <= blobSize - stored._offset;
+		}
+
+		static uint64_t hash(View const &value)
+		{
+			return hashBytes(value.data(), value.size());
+		}
+	};
+
+	struct Header
+	{
+		char _magic[8];
+		uint32_t _version;
+		uint32_t _entrySize;
+		uint64_t _count;
+		uint64_t _bucketCount;
+		uint64_t _blobSize;
+	};
+
+	constexpr char MAGIC[8] = {'U', 'M', 'S', 'N', 'A', 'P', '\0', '\0'};
+	constexpr uint32_t VERSION = 1;
+
+	constexpr uint64_t align8(uint64_t const size)
+	{
+		return (size + 7) & ~uint64_t{7};
+	}
+}
+
+/**
+ * Read only view of an UnorderedMap snapshot file. The file is the lookup
+ * structure itself, so opening it is one mmap and one pass validating the
+ * bucket table and entries against the file size, the string blob is
+ * faulted in by the lookups which touch it.
+ *
+ * File layout, every section 8 byte aligned:
+ *	Header
+ *	uint64_t bucketStart[bucketCount + 1]	first entry of every bucket
+ *	Entry entries[count]			{hash, key, mapped}, grouped by bucket
+ *	char blob[blobSize]			bytes of std::string keys and values
+ *
+ * bucketCount is a power of two, bucket of a key is hash & (bucketCount - 1).
+ * The file is native endian and has no padding control beyond alignment,
+ * it is meant to be written and read on the same platform.
+ */
+template<typename KeyType, typename MappedType>
+class MappedUnorderedMap
+{
+	using KeyTraits = snapshot::Traits<KeyType>;
+	using MappedTraits = snapshot::Traits<MappedType>;
+
+	struct Entry
+	{
+		uint64_t _hash;
+		typename KeyTraits::Stored _key;
+		typename MappedTraits::Stored _mapped;
+	};
+
+public:
+	using KeyView = typename KeyTraits::View;
+	using MappedView = typename MappedTraits::View;
+
+	/**
+	 * Writes the elements of map to path. Map is any container of
+	 * std::pair<const KeyType, MappedType>, e.g. UnorderedMap or FlatUnorderedMap.
+	 */
+	template<typename Map>
+	static void save(Map const &map, std::string const &path)
+	{
+		std::vector<Entry> entries;
+		std::string blob;
+
+		for (auto const &ele: map)
+		{
+			Entry entry{0, KeyTraits::store(ele.first, blob), MappedTraits::store(ele.second, blob)};
+			entry._hash = KeyTraits::hash(KeyTraits::view(entry._key, blob.data()));
+			entries.push_back(entry);
+		}
+
+		uint64_t bucketCount = 1;
+		while (bucketCount < entries.size())
+			bucketCount <<= 1;
+
+		//Counting sort of the entries by bucket
+		std::vector<uint64_t> bucketStart(bucketCount + 1, 0);
+		for (auto const &entry: entries)
+			++bucketStart[(entry._hash & (bucketCount - 1)) + 1];
+
+		for (uint64_t i = 1; i <= bucketCount; ++i)
+			bucketStart[i] += bucketStart[i - 1];
+
+		//Entries are copied field by field into zeroed bytes, padding between
+		//the fields would otherwise leak memory contents into the file
+		std::vector<char> sorted(entries.size() * sizeof(Entry), 0);
+		std::vector<uint64_t> next(bucketStart.begin(), bucketStart.end() - 1);
+		for (auto const &entry: entries)
+		{
+			char *bytes = sorted.data() + next[entry._hash & (bucketCount - 1)]++ * sizeof(Entry);
+			std::memcpy(bytes + offsetof(Entry, _hash), &entry._hash, sizeof(entry._hash));
+			std::memcpy(bytes + offsetof(Entry, _key), &entry._key, sizeof(entry._key));
+			std::memcpy(bytes + offsetof(Entry, _mapped), &entry._mapped, sizeof(entry._mapped));
+		}
+
+		snapshot::Header header{};
+		std::memcpy(header._magic, snapshot::MAGIC, sizeof(header._magic));
+		header._version = snapshot::VERSION;
+		header._entrySize = sizeof(Entry);
+		header._count = entries.size();
+		header._bucketCount = bucketCount;
+		header._blobSize = blob.size();
+
+		//Streams do not report the cause of a failure, errno may be stale
+		std::ofstream out{path, std::ios::binary | std::ios::trunc};
+		if (!out)
+			throw std::ios_base::failure("open " + path);
+
+		char const padding[8] = {};
+		auto write = [&out, &padding](void const *data, uint64_t const size){
+			out.write(static_cast<char const *>(data), size);
+			out.write(padding, snapshot::align8(size) - size);
+		};
+
+		write(&header, sizeof(header));
+		write(bucketStart.data(), bucketStart.size() * sizeof(uint64_t));
+		write(sorted.data(), sorted.size());
+		write(blob.data(), blob.size());
+
+		if (!out.flush())
+			throw std::ios_base::failure("write " + path);
+	}
+
+	explicit MappedUnorderedMap(std::string const &path)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), "open " + path);
+
+		struct stat st{};
+		if (::fstat(fd, &st) < 0)
+		{
+			int const error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), "stat " + path);
+		}
+
+		_size = st.st_size;
+		void *addr = (_size == 0 ? MAP_FAILED : ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0));
+		int const error = errno;
+		::close(fd);
+
+		if (addr == MAP_FAILED)
+			throw std::system_error(_size == 0 ? EINVAL : error, std::generic_category(), "mmap " + path);
+
+		_base = static_cast<char const *>(addr);
+
+		try
+		{
+			validate(path);
+		}
+		catch (...)
+		{
+			::munmap(const_cast<char *>(_base), _size);
+			throw;
+		}
+	}
+
+	MappedUnorderedMap(MappedUnorderedMap const &) = delete;
+	MappedUnorderedMap & operator=(MappedUnorderedMap const &) = delete;
+
+	~MappedUnorderedMap()
+	{
+		::munmap(const_cast<char *>(_base), _size);
+	}
+
+	std::optional<MappedView> find(KeyView const &key) const
+	{
+		uint64_t const hash = KeyTraits::hash(key);
+		uint64_t const bucket = hash & _mask;
+
+		for (uint64_t i = _bucketStart[bucket], end = _bucketStart[bucket + 1]; i < end; ++i)
+		{
+			Entry const &entry = _entries[i];
+			if (entry._hash == hash && KeyTraits::view(entry._key, _blob) == key)
+				return MappedTraits::view(entry._mapped, _blob);
+		}
+
+		return std::nullopt;
+	}
+
+	bool contains(KeyView const &key) const
+	{
+		return find(key).has_value();
+	}
+
+	/**
+	 * Calls func(KeyView, MappedView) for every element
+	 */
+	template<typename F>
+	void forEach(F &&func) const
+	{
+		for (uint64_t i = 0; i < _count; ++i)
+			func(KeyTraits::view(_entries[i]._key, _blob), MappedTraits::view(_entries[i]._mapped, _blob));
+	}
+
+	uint64_t size() const noexcept
+	{
+		return _count;
+	}
+
+	bool empty() const noexcept
+	{
+		return _count == 0;
 	}
 
 private:
-	std::pair<bool, uint32_t> find(KeyType const &key, typename LinkedList<ValueType>::Iterator &itr) const
+	void validate(std::string const &path)
 	{
-		bool findStatus{true};
+		auto fail = [&path](char const *reason){
+			throw std::runtime_error(path + ": " + reason);
+		};
 
-		uint32_t index = getBucketIndex(key);
+		if (_size < sizeof(snapshot::Header))
+			fail("too small for a snapshot");
 
-		itr = _bucket[index].find(ValueType(key, MappedType()), [](ValueType const &lhs, ValueType const &rhs){
-			return lhs.first == rhs.first;
-		});
+		snapshot::Header header;
+		std::memcpy(&header, _base, sizeof(header));
+
+		if (std::memcmp(header._magic, snapshot::MAGIC, sizeof(header._magic)) != 0 || header._version != snapshot::VERSION)
+			fail("not a snapshot of this version");
+
+		if (header._entrySize != sizeof(Entry))
+			fail("written for different key or mapped types");
+
+		if (header._bucketCount == 0 || (header._bucketCount & (header._bucketCount - 1)) != 0)
+			fail("bucket count is not a power of two");
+
+		//Each count is bounded by the file size first, the offsets below can't overflow
+		if (header._bucketCount >= _size / sizeof(uint64_t) || header._count > _size / sizeof(Entry) || header._blobSize > _size)
+			fail("truncated");
+
+		uint64_t const bucketOffset = snapshot::align8(sizeof(header));
+		uint64_t const entryOffset = bucketOffset + snapshot::align8((header._bucketCount + 1) * sizeof(uint64_t));
+		uint64_t const blobOffset = entryOffset + snapshot::align8(header._count * sizeof(Entry));
+
+		if (blobOffset + header._blobSize > _size)
+			fail("truncated");
+
+		_bucketStart = reinterpret_cast<uint64_t const *>(_base + bucketOffset);
+		_entries = reinterpret_cast<Entry const *>(_base + entryOffset);
+		_blob = _base + blobOffset;
+		_count = header._count;
+		_mask = header._bucketCount - 1;
+
+		if (_bucketStart[0] != 0 || _bucketStart[header._bucketCount] != _count)
+			fail("bucket table does not match the element count");
+
+		for (uint64_t i = 0; i < header._bucketCount; ++i)
+			if (_bucketStart[i] > _bucketStart[i + 1])
+				fail("bucket table is not sorted");
+
+		for (uint64_t i = 0; i < _count; ++i)
+			if (! KeyTraits::valid(_entries[i]._key, header._blobSize) || ! MappedTraits::valid(_entries[i]._mapped, header._blobSize))
+				fail("string outside of the blob");
+	}
+
+	char const *_base{nullptr};
+	size_t _size{0};
+	uint64_t const *_bucketStart{nullptr};
+	Entry const *_entries{nullptr};
+	char const *_blob{nullptr};
+	uint64_t _count{0};
+	uint64_t _mask{0};
+};
+
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <filesystem>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+template<typename F>
+double measureNs(uint64_t const operations, F &&func)
+{
+	auto const start = std::chrono::steady_clock::now();
+	func();
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+}
+
+/**
+ * UnorderedMap::insert takes key and value, std::unordered_map takes a pair
+ */
+template<typename Map, typename Key, typename Value>
+void insertKeyValue(Map &map, Key const &key, Value const &value)
+{
+	map.insert(key, value);
+}
+
+template<typename Key, typename Value>
+void insertKeyValue(std::unordered_map<Key, Value> &map, Key const &key, Value const &value)
+{
+	map.insert_or_assign(key, value);
+}
+
+/**
+ * Bytes allocated from the heap and in use, minus what the slab pools hold
+ * without handing it out. The difference of two readings is what a map
+ * occupies, malloc headers included.
+ */
+size_t liveHeapBytes()
+{
+#if defined(__GLIBC__)
+	struct mallinfo2 const info = mallinfo2();
+	return info.uordblks + info.hblkhd - SlabPoolBase::idleBytes();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Insert, hit lookup, miss lookup, full iteration, rehash to twice the
+ * buckets and erase of every key, in ns/op, plus heap bytes per element
+ */
+template<typename Map, typename Key>
+void benchmarkMap(std::string const &name, std::vector<Key> const &keys, std::vector<Key> const &missingKeys)
+{
+	size_t const heapBefore = liveHeapBytes();
+
+	auto map = std::make_unique<Map>();
+	uint64_t found = 0;
 
-		if (itr == _bucket[index].end())
-			findStatus = false;
+	double const insert = measureNs(keys.size(), [&]{
+		for (uint32_t i = 0; i < keys.size(); ++i)
+			insertKeyValue(*map, keys[i], static_cast<int>(i));
+	});
 
-		return {findStatus, index};
+	double const bytes = static_cast<double>(liveHeapBytes() - heapBefore) / keys.size();
+
+	//Look up the end once, it's not free for every map
+	auto const end = map->end();
+
+	double const hit = measureNs(keys.size(), [&]{
+		for (auto const &key: keys)
+			found += (map->find(key) != end);
+	});
+
+	double const miss = measureNs(missingKeys.size(), [&]{
+		for (auto const &key: missingKeys)
+			found += (map->find(key) != end);
+	});
+
+	uint64_t sum = 0;
+	double const iterate = measureNs(keys.size(), [&]{
+		for (auto const &ele: *map)
+			sum += ele.second;
+	});
+
+	double const rehash = measureNs(keys.size(), [&]{
+		map->reserve(2 * keys.size());
+	});
+
+	double const erase = measureNs(keys.size(), [&]{
+		for (auto const &key: keys)
+			found += map->erase(key);
+	});
+
+	if (found != 2 * keys.size() || map->size() != 0 || sum != uint64_t{keys.size()} * (keys.size() - 1) / 2)
+		std::cout << name << " found " << found << " keys out of " << keys.size() << std::endl;
+
+	std::cout << std::left << std::setw(12) << keys.size() << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << insert << std::setw(12) << hit << std::setw(12) << miss << std::setw(12) << iterate
+		<< std::setw(12) << rehash << std::setw(12) << erase << std::setw(12) << bytes << std::endl;
+}
+
+void benchmarkMapHeader(std::string const &keyType)
+{
+	std::cout << std::endl << std::left << std::setw(12) << "Elements" << std::setw(28) << ("Map<" + keyType + ", int>") << std::right
+		<< std::setw(12) << "Insert(ns)" << std::setw(12) << "Hit(ns)" << std::setw(12) << "Miss(ns)" << std::setw(12) << "Iterate(ns)"
+		<< std::setw(12) << "Rehash(ns)" << std::setw(12) << "Erase(ns)" << std::setw(12) << "Bytes/elem" << std::endl;
+}
+
+/**
+ * memory_usage() next to the measured heap growth, in bytes per element of
+ * an int -> int map filled by inserts and of one reserved up front
+ */
+template<typename Map>
+void benchmarkMemory(std::string const &name, uint32_t const size)
+{
+	std::cout << std::left << std::setw(12) << size << std::setw(28) << name << std::right << std::fixed << std::setprecision(2);
+
+	for (bool const reserve: {false, true})
+	{
+		size_t const heapBefore = liveHeapBytes();
+		auto map = std::make_unique<Map>();
+
+		if (reserve)
+			map->reserve(size);
+
+		for (uint32_t i = 0; i < size; ++i)
+			map->insert(static_cast<int>(i), static_cast<int>(i));
+
+		double const heap = static_cast<double>(liveHeapBytes() - heapBefore) / size;
+		std::cout << std::setw(14) << static_cast<double>(map->memory_usage()) / size << std::setw(12) << heap;
+	}
+
+	std::cout << std::endl;
+}
+
+/**
+ * Erase and reinsert every key for a few rounds, node allocation dominates
+ */
+template<typename Map>
+void benchmarkChurn(std::string const &name, std::vector<int> const &keys)
+{
+	Map map;
+
+	for (auto key: keys)
+		insertKeyValue(map, key, key);
+
+	uint32_t const rounds = 4;
+
+	double const churn = measureNs(2ull * rounds * keys.size(), [&]{
+		for (uint32_t round = 0; round < rounds; ++round)
+			for (auto key: keys)
+			{
+				map.erase(key);
+				insertKeyValue(map, key, key + 1);
+			}
+	});
+
+	if (map.size() != keys.size())
+		std::cout << name << " lost " << keys.size() - map.size() << " keys" << std::endl;
+
+	std::cout << std::left << std::setw(12) << keys.size() << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << churn << std::endl;
+}
+
+/**
+ * Latency of every single insert, a stop the world rehash shows up in the max
+ */
+template<typename Map>
+void benchmarkInsertLatency(std::string const &name, Map &map, uint32_t const size)
+{
+	std::vector<double> latency(size);
+
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		auto const start = std::chrono::steady_clock::now();
+		map.insert(i, i);
+		latency[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	std::sort(latency.begin(), latency.end());
+
+	std::cout << std::left << std::setw(12) << size << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << latency[size / 2] << std::setw(12) << latency[size - size / 1000 - 1] << std::setw(14) << latency.back() << std::endl;
+}
+
+/**
+ * UnorderedMap shared the way it's done without ConcurrentUnorderedMap, one mutex around it
+ */
+class LockedUnorderedMap
+{
+public:
+	bool insert(int key, int value)
+	{
+		std::unique_lock<std::mutex> lock{_mutex};
+		return _map.insert(key, value).first;
 	}
 
-	std::pair<bool, uint32_t> insertOrUpdate(
-		LinkedList<ValueType> *bucket,
-		uint32_t const bucketSize,
-		KeyType const &key,
-		MappedType const &mappedValue,
-		typename LinkedList<ValueType>::Iterator &itr
-	) const
+	bool find(int key, int &value)
+	{
+		std::unique_lock<std::mutex> lock{_mutex};
+		auto itr = _map.find(key);
+		if (itr == _map.end())
+			return false;
+		value = itr->second;
+		return true;
+	}
+
+private:
+	std::mutex _mutex;
+	UnorderedMap<int, int> _map;
+};
+
+/**
+ * Every thread does the same number of operations on random keys of a prefilled map,
+ * writePercent of them are inserts and rest are lookups. Reports total Mops/s.
+ */
+template<typename Map>
+double benchmarkThreads(Map &map, uint32_t const keyRange, uint32_t const threadCount, uint32_t const writePercent)
+{
+	constexpr uint32_t operations = 200000;
+	std::atomic<uint64_t> found{0};
+	std::vector<std::thread> threads;
+
+	auto const start = std::chrono::steady_clock::now();
+
+	for (uint32_t t = 0; t < threadCount; ++t)
 	{
-		bool insertStatus{false};
-		uint32_t index = getBucketIndex(key, bucketSize);
+		threads.emplace_back([&map, &found, keyRange, writePercent, t](){
+			std::mt19937 engine{t};
+			uint64_t hits = 0;
+			int value = 0;
+
+			for (uint32_t i = 0; i < operations; ++i)
+			{
+				uint32_t const random = engine();
+				int const key = random % keyRange;
+
+				if ((random >> 24) % 100 < writePercent)
+					map.insert(key, i);
+				else
+					hits += map.find(key, value);
+			}
 
-		itr = bucket[index].find(ValueType(key, MappedType()), [](ValueType const &lhs, ValueType const &rhs){
-			return lhs.first == rhs.first;
+			found.fetch_add(hits, std::memory_order_relaxed);
 		});
+	}
+
+	for (auto &thread: threads)
+		thread.join();
+
+	double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return (static_cast<double>(operations) * threadCount) / seconds / 1e6;
+}
+
+void benchmarkConcurrent(uint32_t const keyRange)
+{
+	std::cout << std::endl << std::left << std::setw(12) << "Threads" << std::setw(28) << "Workload" << std::right
+		<< std::setw(16) << "Mutex(Mops)" << std::setw(16) << "Sharded(Mops)" << std::endl;
 
-		if (itr == bucket[index].end())
+	for (uint32_t writePercent: {0, 5, 50})
+	{
+		for (uint32_t threadCount = 1; threadCount <= 64; threadCount *= 2)
 		{
-			bucket[index].push_back(ValueType(key, mappedValue));
-			itr = bucket[index].begin();
-			insertStatus = true;
+			LockedUnorderedMap locked;
+			ConcurrentUnorderedMap<int, int> sharded;
+
+			for (uint32_t i = 0; i < keyRange; i += 2)
+			{
+				locked.insert(i, i);
+				sharded.insert(i, i);
+			}
+
+			double const lockedRate = benchmarkThreads(locked, keyRange, threadCount, writePercent);
+			double const shardedRate = benchmarkThreads(sharded, keyRange, threadCount, writePercent);
+
+			std::cout << std::left << std::setw(12) << threadCount << std::setw(28) << (std::to_string(writePercent) + "% writes") << std::right
+				<< std::fixed << std::setprecision(2) << std::setw(16) << lockedRate << std::setw(16) << shardedRate << std::endl;
 		}
-		else
+	}
+}
+
+/**
+ * Full traversal in ns per element, of the full map and after erasing 15 of
+ * every 16 elements, when the buckets are mostly empty
+ */
+template<typename Map>
+void benchmarkIteration(std::string const &name, uint32_t const size)
+{
+	Map map;
+	for (uint32_t i = 0; i < size; ++i)
+		insertKeyValue(map, static_cast<int>(i), static_cast<int>(i));
+
+	auto traverse = [&map]{
+		uint64_t sum = 0, count = 0;
+		double const ns = measureNs(map.size(), [&]{
+			for (auto const &ele: map)
+			{
+				sum += ele.second;
+				++count;
+			}
+		});
+
+		if (count != map.size())
+			std::cout << "iterated " << count << " elements out of " << map.size() << ", " << sum << std::endl;
+
+		return ns;
+	};
+
+	double const full = traverse();
+
+	for (uint32_t i = 0; i < size; ++i)
+		if (i % 16 != 0)
+			map.erase(static_cast<int>(i));
+
+	double const sparse = traverse();
+
+	std::cout << std::left << std::setw(12) << size << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << full << std::setw(12) << sparse << std::endl;
+}
+
+/**
+ * Loading size random pairs one insert at a time, after reserve and with build
+ */
+void benchmarkBulkLoad(uint32_t const size)
+{
+	std::cout << std::endl << std::left << std::setw(12) << "Elements" << std::setw(28) << "Bulk load" << std::right
+		<< std::setw(12) << "Load(ns)" << std::setw(12) << "Hit(ns)" << std::setw(12) << "Rehashes" << std::endl;
+
+	std::mt19937 engine{size};
+	std::vector<std::pair<int, int>> elements(size);
+
+	for (uint32_t i = 0; i < size; ++i)
+		elements[i] = {static_cast<int>(i), static_cast<int>(engine())};
+
+	std::shuffle(elements.begin(), elements.end(), engine);
+
+	//Maps live until the end, nodes of a destroyed map would be handed to the
+	//next row through the allocator free lists in scattered order
+	std::vector<std::unique_ptr<UnorderedMap<int, int>>> maps;
+
+	//A rehash changes the bucket count which prepare left
+	auto run = [&elements, &maps](std::string const &name, auto &&prepare, auto &&load){
+		UnorderedMap<int, int> &map = *maps.emplace_back(std::make_unique<UnorderedMap<int, int>>());
+		prepare(map);
+		uint32_t const bucketCount = map.bucketCount();
+
+		double const loadNs = measureNs(elements.size(), [&]{
+			load(map);
+		});
+
+		uint64_t found = 0;
+		double const hit = measureNs(elements.size(), [&]{
+			for (auto const &ele: elements)
+				found += map.find(ele.first)->second == ele.second;
+		});
+
+		if (found != elements.size())
+			std::cout << name << " found " << found << " elements out of " << elements.size() << std::endl;
+
+		std::cout << std::left << std::setw(12) << elements.size() << std::setw(28) << name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << loadNs << std::setw(12) << hit << std::setw(12) << (map.bucketCount() != bucketCount ? "yes" : "no") << std::endl;
+	};
+
+	auto insertAll = [&elements](UnorderedMap<int, int> &map){
+		for (auto const &ele: elements)
+			map.insert(ele.first, ele.second);
+	};
+
+	run("insert", [](UnorderedMap<int, int> &){}, insertAll);
+	run("reserve + insert", [&elements](UnorderedMap<int, int> &map){ map.reserve(elements.size()); }, insertAll);
+
+	//build sizes the table itself, prepare only computes the same bucket count
+	run("build", [&elements](UnorderedMap<int, int> &map){ map.reserve(elements.size()); }, [&elements](UnorderedMap<int, int> &map){
+		map.build(elements);
+	});
+}
+
+/**
+ * Startup of a lookup table: rebuilding it one insert at a time vs mapping
+ * a snapshot file, followed by random hit lookups on the mapped file
+ */
+void benchmarkSnapshot(uint32_t const size)
+{
+	std::cout << std::endl << std::left << std::setw(12) << "Elements" << std::setw(28) << "Snapshot<int, string>" << std::right
+		<< std::setw(14) << "Rebuild(ms)" << std::setw(12) << "Save(ms)" << std::setw(12) << "Load(ms)" << std::setw(12) << "Hit(ns)" << std::endl;
+
+	std::string const path = (std::filesystem::temp_directory_path() / "unordered_map_benchmark.snapshot").string();
+	std::mt19937 engine{size};
+	std::vector<int> keys(size);
+
+	for (uint32_t i = 0; i < size; ++i)
+		keys[i] = static_cast<int>(i);
+
+	std::shuffle(keys.begin(), keys.end(), engine);
+
+	UnorderedMap<int, std::string> map;
+
+	double const rebuild = measureNs(1000000, [&]{
+		for (auto key: keys)
+			map.insert(key, "value-" + std::to_string(key));
+	});
+
+	double const save = measureNs(1000000, [&]{
+		MappedUnorderedMap<int, std::string>::save(map, path);
+	});
+
+	std::unique_ptr<MappedUnorderedMap<int, std::string>> mapped;
+	double const load = measureNs(1000000, [&]{
+		mapped = std::make_unique<MappedUnorderedMap<int, std::string>>(path);
+	});
+
+	uint64_t length = 0;
+	double const hit = measureNs(keys.size(), [&]{
+		for (auto key: keys)
+			length += mapped->find(key)->size();
+	});
+
+	std::filesystem::remove(path);
+
+	if (mapped->size() != size || length == 0)
+		std::cout << "snapshot lost keys" << std::endl;
+
+	std::cout << std::left << std::setw(12) << size << std::setw(28) << "UnorderedMap -> mmap" << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(14) << rebuild << std::setw(12) << save << std::setw(12) << load << std::setw(12) << hit << std::endl;
+}
+
+void benchmark(uint32_t const maxSize)
+{
+	benchmarkMapHeader("int");
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
+	{
+		std::mt19937 engine{size};
+		std::vector<int> keys(size), missingKeys(size);
+
+		//Even keys are inserted, odd keys are guaranteed misses
+		for (uint32_t i = 0; i < size; ++i)
 		{
-			itr->second = mappedValue;
+			keys[i] = static_cast<int>(engine() & ~1u);
+			missingKeys[i] = static_cast<int>(engine() | 1u);
 		}
 
-		return {insertStatus, index};
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		std::shuffle(keys.begin(), keys.end(), engine);
+
+		benchmarkMap<UnorderedMap<int, int>>("UnorderedMap", keys, missingKeys);
+		benchmarkMap<FlatUnorderedMap<int, int>>("FlatUnorderedMap", keys, missingKeys);
+		benchmarkMap<CompactUnorderedMap<int, int>>("CompactUnorderedMap", keys, missingKeys);
+		benchmarkMap<std::unordered_map<int, int>>("std::unordered_map", keys, missingKeys);
 	}
 
-	uint32_t firstNonEmptyBucketIndex() const noexcept
+	//Keys of 10 to 14 characters, within the small string buffer of libstdc++
+	benchmarkMapHeader("string");
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
 	{
-		for (uint32_t i = 0; i < _bucketSize; ++i)
-			if (! _bucket[i].empty())
-				return i;
+		std::mt19937_64 engine{size};
+		std::vector<std::string> keys(size), missingKeys(size);
 
-		return 0;
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			keys[i] = "key:" + std::to_string(i * 1000003ull % 1000000007ull);
+			missingKeys[i] = "miss:" + std::to_string(engine() % 1000000000ull);
+		}
+
+		benchmarkMap<UnorderedMap<std::string, int>>("UnorderedMap", keys, missingKeys);
+		benchmarkMap<FlatUnorderedMap<std::string, int>>("FlatUnorderedMap", keys, missingKeys);
+		benchmarkMap<CompactUnorderedMap<std::string, int>>("CompactUnorderedMap", keys, missingKeys);
+		benchmarkMap<std::unordered_map<std::string, int>>("std::unordered_map", keys, missingKeys);
 	}
 
-	uint32_t lastNonEmptyBucketIndex() const noexcept
+	std::cout << std::endl << std::left << std::setw(12) << "Elements" << std::setw(28) << "Memory<int, int>" << std::right
+		<< std::setw(14) << "Reported(B)" << std::setw(12) << "Heap(B)" << std::setw(14) << "Reserved(B)" << std::setw(12) << "Heap(B)" << std::endl;
+
+	benchmarkMemory<UnorderedMap<int, int>>("UnorderedMap", maxSize);
+	benchmarkMemory<FlatUnorderedMap<int, int>>("FlatUnorderedMap", maxSize);
+	benchmarkMemory<CompactUnorderedMap<int, int>>("CompactUnorderedMap", maxSize);
+
+	benchmarkMapHeader("int");
+
+	//Bucket policies with sequential keys and keys which are multiples of 4096,
+	//latter share a handful of buckets when an identity hash is reduced by % 2^n
+	uint32_t const size = std::min<uint32_t>(maxSize, 100000);
+
+	for (std::string const keySet: {"sequential", "stride-4096"})
 	{
-		for (uint32_t i = _bucketSize - 1; i > 0; --i)
-			if (! _bucket[i].empty())
-				return i;
+		std::vector<int> keys(size), missingKeys(size);
+
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			keys[i] = (keySet == "sequential" ? i : i << 12);
+			missingKeys[i] = (keySet == "sequential" ? size + i : (i << 12) + 1);
+		}
+
+		using Hash = std::hash<int>;
+		using Equal = std::equal_to<int>;
 
-		return (! _bucket[0].empty()) ? 0 : (_bucketSize - 1);
+		benchmarkMap<UnorderedMap<int, int>>("Modulo " + keySet, keys, missingKeys);
+		benchmarkMap<UnorderedMap<int, int, Hash, Equal, PowerOfTwoBucketPolicy<FibonacciMixer>>>("Fibonacci " + keySet, keys, missingKeys);
+		benchmarkMap<UnorderedMap<int, int, Hash, Equal, PowerOfTwoBucketPolicy<WyMixer>>>("Wy " + keySet, keys, missingKeys);
 	}
 
-	uint32_t getBucketIndex(KeyType const &key, uint32_t bucketSize=0) const noexcept
+	std::cout << std::endl << std::left << std::setw(12) << "Elements" << std::setw(28) << "Node allocator" << std::right
+		<< std::setw(12) << "Churn(ns)" << std::endl;
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
 	{
-		uint32_t const size = (bucketSize == 0 ? _bucketSize : bucketSize);
-		return _hash(key) % size;
-	}
+		std::vector<int> keys(size);
 
-	LinkedList<ValueType> *_bucket{nullptr};
-	uint32_t _bucketSize{0};
-	Hasher _hash{};
-	uint32_t _maxLoadFactor{1};
-	uint32_t _count{0};
-	uint8_t _bucketSizeMultiplierFactor{2};
-};
+		for (uint32_t i = 0; i < size; ++i)
+			keys[i] = static_cast<int>(i);
 
-template<typename T1, typename T2>
-std::ostream & operator<<(std::ostream &out, UnorderedMap<T1, T2> const &map)
-{
-	if (map.empty())
-		return out;
+		std::shuffle(keys.begin(), keys.end(), std::mt19937{size});
 
-	auto start = map.begin(), end = map.end();
+		using Hash = std::hash<int>;
+		using Equal = std::equal_to<int>;
 
-	out << *start;
+		benchmarkChurn<UnorderedMap<int, int, Hash, Equal, ModuloBucketPolicy, SlabAllocator<std::pair<const int, int>>>>("SlabAllocator", keys);
+		benchmarkChurn<UnorderedMap<int, int>>("std::allocator", keys);
+		benchmarkChurn<std::unordered_map<int, int>>("std::unordered_map", keys);
+	}
 
-	for (++start; start != end; ++start)
-		out << ", " << *start;
+	std::cout << std::endl << std::left << std::setw(12) << "Elements" << std::setw(28) << "Rehash" << std::right
+		<< std::setw(12) << "p50(ns)" << std::setw(12) << "p99.9(ns)" << std::setw(14) << "Max(ns)" << std::endl;
 
-	return out;
+	for (uint32_t step: {0, 1, 8})
+	{
+		UnorderedMap<int, int> map;
+		map.setIncrementalRehash(step);
+		benchmarkInsertLatency(step == 0 ? std::string("All at once") : "Incremental, " + std::to_string(step) + " per insert", map, maxSize);
+	}
+
+	benchmarkConcurrent(std::min<uint32_t>(maxSize, 1000000));
+	std::cout << std::endl << std::left << std::setw(12) << "Elements" << std::setw(28) << "Iteration" << std::right
+		<< std::setw(12) << "Full(ns)" << std::setw(12) << "Sparse(ns)" << std::endl;
+
+	for (uint32_t size = 1000; size <= maxSize; size *= 10)
+	{
+		benchmarkIteration<UnorderedMap<int, int>>("UnorderedMap", size);
+		benchmarkIteration<FlatUnorderedMap<int, int>>("FlatUnorderedMap", size);
+		benchmarkIteration<std::unordered_map<int, int>>("std::unordered_map", size);
+	}
+
+	benchmarkBulkLoad(maxSize);
+	benchmarkSnapshot(maxSize);
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	//./a.out --benchmark [max elements, default 1M, up to 100M with enough memory]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		benchmark(argc > 2 ? std::stoul(argv[2]) : 1000000);
+		return 0;
+	}
+
 	UnorderedMap<int, std::string> map{
 		{1, "A"},
 		{2, "B"},
@@ -741,6 +4042,75 @@ int main()
 	for (; itr != map.end(); ++itr)
 		std::cout << *itr << ", ";
 
+	std::cout << std::endl;
+
+	UnorderedMap<std::string, int, StringHash, std::equal_to<>> symbols;
+
+	std::string name{"thread_pool"};
+	symbols.insert(std::move(name), 1);
+	symbols.try_emplace("timer_thread", 2);
+	symbols.try_emplace("timer_thread", 3);
+	symbols["logger"] = 4;
+
+	std::string_view const view{"timer_thread"};
+	auto symbolItr = symbols.find(view);
+	if (symbolItr != symbols.end())
+		std::cout << "Found " << *symbolItr << std::endl;
+
+	std::cout << std::boolalpha << symbols.erase(std::string_view{"logger"}) << ", " << symbols << std::endl;
+
+	FlatUnorderedMap<int, std::string> flatMap{
+		{1, "A"},
+		{2, "B"},
+		{3, "C"},
+		{1, "A1"},
+	};
+
+	flatMap[4] = "D";
+	flatMap.erase(2);
+
+	auto flatItr = flatMap.find(3);
+	if (flatItr != flatMap.end())
+		flatItr->second = "C1";
+
+	std::cout << flatMap.size() << " => " << flatMap << std::endl;
+
+	CompactUnorderedMap<int, int> compactMap{{1, 10}, {2, 20}, {3, 30}};
+	compactMap.erase(1);
+	compactMap[4] = 40;
+
+	std::cout << compactMap << ", " << compactMap.memory_usage() << " bytes, chained: " << map.memory_usage() << " bytes" << std::endl;
+
+	//A moved from map is empty and usable
+	CompactUnorderedMap<int, int> movedMap{std::move(compactMap)};
+	std::cout << (compactMap.find(2) == compactMap.end()) << ", " << compactMap.erase(2) << ", ";
+	compactMap[5] = 50;
+	compactMap.insert(6, 60);
+	std::cout << compactMap << " | " << movedMap << std::endl;
+
+	ConcurrentUnorderedMap<int, int> sharedMap;
+	std::vector<std::thread> writers;
+
+	for (int t = 0; t < 4; ++t)
+		writers.emplace_back([&sharedMap, t](){
+			for (int i = 0; i < 1000; ++i)
+				sharedMap.insert(t * 1000 + i, i);
+		});
+
+	for (auto &writer: writers)
+		writer.join();
+
+	int value{0};
+	sharedMap.update(3999, [](int &mapped){ mapped *= 2; });
+	std::cout << sharedMap.size() << ", " << std::boolalpha << sharedMap.find(3999, value) << " => " << value << std::endl;
+
+	std::string const snapshotPath = (std::filesystem::temp_directory_path() / "unordered_map_demo.snapshot").string();
+	MappedUnorderedMap<int, std::string>::save(map, snapshotPath);
+
+	MappedUnorderedMap<int, std::string> mapped{snapshotPath};
+	std::cout << mapped.size() << " mapped, 5 => " << mapped.find(5).value_or("-") << ", 42 => " << mapped.find(42).value_or("-") << std::endl;
+	std::filesystem::remove(snapshotPath);
+
 	return 0;
 }
 